@@ -2,6 +2,9 @@
 #include <vector>
 #include <fstream>
 #include <string>
+#include <utility>
+
+#include "Project/question_store.h"
 using namespace std;
 
 // --- Admin, Student, and Teacher classes ---
@@ -71,89 +74,36 @@ public:
     }
 };
 
-// --- Question, MultipleChoiceQuestion, and TrueFalseQuestion classes ---
-
-// Abstract class Question
-class Question {
-protected:
-    string questionText;  // Text of the question
-public:
-    // Constructor to initialize question text
-    Question(string qText) : questionText(qText) {}
-
-    // Virtual functions to be implemented by derived classes
-    virtual void displayQuestion() = 0;
-    virtual bool checkAnswer(int answer) = 0;
-
-    // Virtual destructor
-    virtual ~Question() {}
-};
-
-// MultipleChoiceQuestion inherits from Question
-class MultipleChoiceQuestion : public Question {
-private:
-    vector<string> options;  // List of multiple-choice options
-    int correctAnswer;       // Index of the correct answer
-public:
-    // Constructor to initialize the question, options, and correct answer
-    MultipleChoiceQuestion(string qText, vector<string> opts, int correctAns)
-        : Question(qText), options(opts), correctAnswer(correctAns) {}
-
-    // Display the question and options
-    void displayQuestion() override {
-        cout << questionText << endl;
-        for (size_t i = 0; i < options.size(); ++i) {
-            cout << i + 1 << ". " << options[i] << endl;
-        }
-    }
-
-    // Check if the answer is correct
-    bool checkAnswer(int answer) override {
-        return answer == correctAnswer;
-    }
-};
+// --- Quiz Class to manage the quiz ---
 
-// TrueFalseQuestion inherits from Question
-class TrueFalseQuestion : public Question {
+class Quiz {
 private:
-    int correctAnswer;  // 1 for True, 2 for False
+    QuestionStore questions;  // All questions of the quiz
 public:
-    // Constructor to initialize question and correct answer
-    TrueFalseQuestion(string qText, int correctAns)
-        : Question(qText), correctAnswer(correctAns) {}
-
-    // Display the question with True/False options
-    void displayQuestion() override {
-        cout << questionText << endl;
-        cout << "1. True\n2. False" << endl;
+    // Add a multiple choice question to the quiz
+    void addMultipleChoiceQuestion(const string& qText, const vector<string>& options, int correctAns) {
+        questions.addMultipleChoice(qText, options, correctAns);
     }
 
-    // Check if the answer is correct
-    bool checkAnswer(int answer) override {
-        return answer == correctAnswer;
+    // Add a true/false question to the quiz
+    void addTrueFalseQuestion(const string& qText, int correctAns) {
+        questions.addTrueFalse(qText, correctAns);
     }
-};
-
-// --- Quiz Class to manage the quiz ---
 
-class Quiz {
-private:
-    vector<Question*> questions;  // List of questions
-public:
-    // Add a question to the quiz
-    void addQuestion(Question* q) {
-        questions.push_back(q);
+    // Heap allocations made to hold the questions
+    size_t allocationCount() const {
+        return questions.allocationCount();
     }
 
     // Start the quiz for a student
     int startQuiz() {
         int score = 0;
-        for (auto& q : questions) {
-            q->displayQuestion();
+        for (size_t i = 0; i < questions.size(); ++i) {
+            questions.displayQuestion(i);
             int answer;
             cout << "Your answer: ";
             cin >> answer;
-            if (q->checkAnswer(answer)) {
+            if (questions.checkAnswer(i, answer)) {
                 cout << "Correct!\n";
                 score += 10;  // Add 10 points for each correct answer
             } else {
@@ -163,13 +113,6 @@ public:
         }
         return score;  // Return the total score
     }
-
-    // Destructor to clean up dynamic memory
-    ~Quiz() {
-        for (auto& q : questions) {
-            delete q;
-        }
-    }
 };
 
 // --- Main Program ---
@@ -187,7 +130,7 @@ int main() {
 
         if (choice == 1) {
             int adminChoice;
-            cout << "Admin Mode:\n1. Add Multiple Choice Question\n2. Add True/False Question\n";
+            cout << "Admin Mode:\n1. Add Multiple Choice Question\n2. Add True/False Question\n3. Show Memory Use\n";
             cout << "Choose an option: ";
             cin >> adminChoice;
 
@@ -207,13 +150,13 @@ int main() {
                     string option;
                     cout << "Enter option " << i + 1 << ": ";
                     getline(cin, option);
-                    options.push_back(option);
+                    options.push_back(move(option));
                 }
 
                 cout << "Enter the correct option number: ";
                 cin >> correctAns;
 
-                quiz.addQuestion(new MultipleChoiceQuestion(qText, options, correctAns));
+                quiz.addMultipleChoiceQuestion(qText, options, correctAns);
                 cout << "Question added successfully!\n";
             } else if (adminChoice == 2) {
                 string qText;
@@ -225,8 +168,10 @@ int main() {
                 cout << "Enter the correct answer (1 for True, 2 for False): ";
                 cin >> correctAns;
 
-                quiz.addQuestion(new TrueFalseQuestion(qText, correctAns));
+                quiz.addTrueFalseQuestion(qText, correctAns);
                 cout << "Question added successfully!\n";
+            } else if (adminChoice == 3) {
+                cout << "Allocations for questions: " << quiz.allocationCount() << endl;
             }
         } else if (choice == 2) {
             string studentName;
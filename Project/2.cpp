@@ -1,8 +1,11 @@
 #include <iostream>
 #include <string>
+#include <vector>
+
+#include "question_store.h"
 using namespace std;
 
-const int MAX_QUESTIONS = 100;  // Maximum number of questions in the quiz
+const size_t MAX_QUESTIONS = 100;  // Maximum number of questions in the quiz
 const int MAX_OPTIONS = 4;      // Maximum number of options for multiple choice questions
 
 // --- Admin, Student, and Teacher classes ---
@@ -72,88 +75,25 @@ public:
     }
 };
 
-// --- Question, MultipleChoiceQuestion, and TrueFalseQuestion classes ---
-
-// Abstract class Question
-class Question {
-protected:
-    string questionText;  // Text of the question
-public:
-    // Constructor to initialize question text
-    Question(string qText) : questionText(qText) {}
-
-    // Virtual functions to be implemented by derived classes
-    virtual void displayQuestion() = 0;
-    virtual bool checkAnswer(int answer) = 0;
-
-    // Virtual destructor
-    virtual ~Question() {}
-};
-
-// MultipleChoiceQuestion inherits from Question
-class MultipleChoiceQuestion : public Question {
-private:
-    string options[MAX_OPTIONS];  // Array of multiple-choice options
-    int correctAnswer;            // Index of the correct answer
-    int numOptions;               // Number of options for this question
-public:
-    // Constructor to initialize the question, options, and correct answer
-    MultipleChoiceQuestion(string qText, string opts[], int numOpts, int correctAns)
-        : Question(qText), numOptions(numOpts), correctAnswer(correctAns) {
-        for (int i = 0; i < numOptions; ++i) {
-            options[i] = opts[i];
-        }
-    }
-
-    // Display the question and options
-    void displayQuestion() override {
-        cout << questionText << endl;
-        for (int i = 0; i < numOptions; ++i) {
-            cout << i + 1 << ". " << options[i] << endl;
-        }
-    }
-
-    // Check if the answer is correct
-    bool checkAnswer(int answer) override {
-        return answer == correctAnswer;
-    }
-};
-
-// TrueFalseQuestion inherits from Question
-class TrueFalseQuestion : public Question {
-private:
-    int correctAnswer;  // 1 for True, 2 for False
-public:
-    // Constructor to initialize question and correct answer
-    TrueFalseQuestion(string qText, int correctAns)
-        : Question(qText), correctAnswer(correctAns) {}
-
-    // Display the question with True/False options
-    void displayQuestion() override {
-        cout << questionText << endl;
-        cout << "1. True\n2. False" << endl;
-    }
-
-    // Check if the answer is correct
-    bool checkAnswer(int answer) override {
-        return answer == correctAnswer;
-    }
-};
-
 // --- Quiz Class to manage the quiz ---
 
 class Quiz {
 private:
-    Question* questions[MAX_QUESTIONS];  // Array of question pointers
-    int questionCount;  // Track the number of questions added
+    QuestionStore questions;  // All questions of the quiz
 public:
-    // Constructor to initialize the question count
-    Quiz() : questionCount(0) {}
+    // Add a multiple choice question to the quiz
+    void addMultipleChoiceQuestion(const string& qText, const string options[], int numOptions, int correctAns) {
+        if (questions.size() < MAX_QUESTIONS) {
+            questions.addMultipleChoice(qText, options, numOptions, correctAns);
+        } else {
+            cout << "Question limit reached!" << endl;
+        }
+    }
 
-    // Add a question to the quiz
-    void addQuestion(Question* q) {
-        if (questionCount < MAX_QUESTIONS) {
-            questions[questionCount++] = q;
+    // Add a true/false question to the quiz
+    void addTrueFalseQuestion(const string& qText, int correctAns) {
+        if (questions.size() < MAX_QUESTIONS) {
+            questions.addTrueFalse(qText, correctAns);
         } else {
             cout << "Question limit reached!" << endl;
         }
@@ -162,12 +102,12 @@ public:
     // Start the quiz for a student
     int startQuiz() {
         int score = 0;
-        for (int i = 0; i < questionCount; ++i) {
-            questions[i]->displayQuestion();
+        for (size_t i = 0; i < questions.size(); ++i) {
+            questions.displayQuestion(i);
             int answer;
             cout << "Your answer: ";
             cin >> answer;
-            if (questions[i]->checkAnswer(answer)) {
+            if (questions.checkAnswer(i, answer)) {
                 cout << "Correct!\n";
                 score += 10;  // Add 10 points for each correct answer
             } else {
@@ -177,13 +117,6 @@ public:
         }
         return score;  // Return the total score
     }
-
-    // Destructor to clean up dynamic memory
-    ~Quiz() {
-        for (int i = 0; i < questionCount; ++i) {
-            delete questions[i];
-        }
-    }
 };
 
 // --- Main Program ---
@@ -225,7 +158,7 @@ int main() {
                 cout << "Enter the correct option number: ";
                 cin >> correctAns;
 
-                quiz.addQuestion(new MultipleChoiceQuestion(qText, options, numOptions, correctAns));
+                quiz.addMultipleChoiceQuestion(qText, options, numOptions, correctAns);
                 cout << "Question added successfully!\n";
             } else if (adminChoice == 2) {
                 string qText;
@@ -237,7 +170,7 @@ int main() {
                 cout << "Enter the correct answer (1 for True, 2 for False): ";
                 cin >> correctAns;
 
-                quiz.addQuestion(new TrueFalseQuestion(qText, correctAns));
+                quiz.addTrueFalseQuestion(qText, correctAns);
                 cout << "Question added successfully!\n";
             }
         } else if (choice == 2) {
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
+
+#include "question_store.h"
 using namespace std;
 
 const int MAX_OPTIONS = 4;  // Maximum number of options for multiple choice questions
@@ -72,74 +75,6 @@ public:
     }
 };
 
-// --- Question, MultipleChoiceQuestion, and TrueFalseQuestion classes ---
-
-// Abstract class Question
-class Question {
-protected:
-    string questionText;  // Text of the question
-public:
-    // Constructor to initialize question text
-    Question(string qText) : questionText(qText) {}
-
-    // Virtual functions to be implemented by derived classes
-    virtual void displayQuestion() = 0;
-    virtual bool checkAnswer(int answer) = 0;
-
-    // Virtual destructor
-    virtual ~Question() {}
-};
-
-// MultipleChoiceQuestion inherits from Question
-class MultipleChoiceQuestion : public Question {
-private:
-    string options[MAX_OPTIONS];  // Array of multiple-choice options
-    int correctAnswer;            // Index of the correct answer
-    int numOptions;               // Number of options for this question
-public:
-    // Constructor to initialize the question, options, and correct answer
-    MultipleChoiceQuestion(string qText, string opts[], int numOpts, int correctAns)
-        : Question(qText), numOptions(numOpts), correctAnswer(correctAns) {
-        for (int i = 0; i < numOptions; ++i) {
-            options[i] = opts[i];
-        }
-    }
-
-    // Display the question and options
-    void displayQuestion() override {
-        cout << questionText << endl;
-        for (int i = 0; i < numOptions; ++i) {
-            cout << i + 1 << ". " << options[i] << endl;
-        }
-    }
-
-    // Check if the answer is correct
-    bool checkAnswer(int answer) override {
-        return answer == correctAnswer;
-    }
-};
-
-// TrueFalseQuestion inherits from Question
-class TrueFalseQuestion : public Question {
-private:
-    int correctAnswer;  // 1 for True, 2 for False
-public:
-    // Constructor to initialize question and correct answer
-    TrueFalseQuestion(string qText, int correctAns)
-        : Question(qText), correctAnswer(correctAns) {}
-
-    // Display the question with True/False options
-    void displayQuestion() override {
-        cout << questionText << endl;
-        cout << "1. True\n2. False" << endl;
-    }
-
-    // Check if the answer is correct
-    bool checkAnswer(int answer) override {
-        return answer == correctAnswer;
-    }
-};
-
 // --- Quiz Class to manage the quiz ---
 
 class Quiz {
@@ -175,17 +110,15 @@ public:
         }
     }
 
-    // Function to start the quiz by reading questions from the file
-    int startQuiz() {
+    // Function to load every question from the file into the store
+    bool loadQuestions(QuestionStore& store) {
         ifstream file("questions.txt");
         if (!file.is_open()) {
             cout << "Unable to open file for reading!\n";
-            return 0;
+            return false;
         }
 
         string line;
-        int score = 0;
-
         while (getline(file, line)) {
             if (line == "MCQ") {
                 string qText, options[MAX_OPTIONS];
@@ -197,22 +130,7 @@ public:
                 }
                 file >> correctAns;
                 file.ignore();  // Ignore the newline after the correct answer
-
-                // Display the multiple-choice question
-                MultipleChoiceQuestion mcq(qText, options, numOptions, correctAns);
-                mcq.displayQuestion();
-                
-                int answer;
-                cout << "Your answer: ";
-                cin >> answer;
-
-                if (mcq.checkAnswer(answer)) {
-                    cout << "Correct!\n";
-                    score += 10;  // Add 10 points for each correct answer
-                } else {
-                    cout << "Wrong!\n";
-                }
-                cout << endl;
+                store.addMultipleChoice(qText, options, numOptions, correctAns);
             } else if (line == "TF") {
                 string qText;
                 int correctAns;
@@ -220,26 +138,35 @@ public:
                 getline(file, qText);
                 file >> correctAns;
                 file.ignore();  // Ignore the newline after the correct answer
+                store.addTrueFalse(qText, correctAns);
+            }
+        }
 
-                // Display the true/false question
-                TrueFalseQuestion tfq(qText, correctAns);
-                tfq.displayQuestion();
+        file.close();
+        return true;
+    }
 
-                int answer;
-                cout << "Your answer: ";
-                cin >> answer;
+    // Function to start the quiz with the questions in the file
+    int startQuiz() {
+        QuestionStore questions;
+        if (!loadQuestions(questions)) {
+            return 0;
+        }
 
-                if (tfq.checkAnswer(answer)) {
-                    cout << "Correct!\n";
-                    score += 10;  // Add 10 points for each correct answer
-                } else {
-                    cout << "Wrong!\n";
-                }
-                cout << endl;
+        int score = 0;
+        for (size_t i = 0; i < questions.size(); ++i) {
+            questions.displayQuestion(i);
+            int answer;
+            cout << "Your answer: ";
+            cin >> answer;
+            if (questions.checkAnswer(i, answer)) {
+                cout << "Correct!\n";
+                score += 10;  // Add 10 points for each correct answer
+            } else {
+                cout << "Wrong!\n";
             }
+            cout << endl;
         }
-
-        file.close();
         return score;  // Return the total score
     }
 };
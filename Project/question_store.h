@@ -0,0 +1,191 @@
+#ifndef QUESTION_STORE_H
+#define QUESTION_STORE_H
+
+// Question storage shared by 2.cpp, Project/2.cpp, Project/3.cpp and
+// question_store_benchmark.cpp, so all of them run the same code.
+//
+// Questions are kept in a few flat arrays instead of one heap object each,
+// and graded by their option number without virtual calls. Question and
+// option texts are packed into the large blocks of a TextArena, which never
+// move and are freed block by block when the store goes away.
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Kinds of question, stored as a one-byte tag per question
+enum QuestionType : unsigned char {
+    MULTIPLE_CHOICE,
+    TRUE_FALSE
+};
+
+// A piece of text kept in a TextArena
+struct TextRef {
+    const char* data;
+    size_t length;
+};
+
+// Memory for question and option texts. Texts are packed into large blocks
+// that never move, so adding text never copies what is already stored, and
+// the whole arena is freed block by block instead of string by string.
+class TextArena {
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<char*> blocks;  // Every block, the current one last
+    size_t used;                // Bytes used in the current block
+    size_t available;           // Size of the current block
+    size_t allocations;         // Blocks allocated so far
+
+public:
+    TextArena() : used(0), available(0), allocations(0) {}
+
+    // The arena owns its blocks, so it can be moved but not copied
+    TextArena(const TextArena&) = delete;
+    TextArena& operator=(const TextArena&) = delete;
+    TextArena(TextArena&& other)
+        : blocks(std::move(other.blocks)), used(other.used), available(other.available), allocations(other.allocations) {
+        other.blocks.clear();
+        other.used = other.available = 0;
+    }
+
+    ~TextArena() {
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            delete[] blocks[i];
+        }
+    }
+
+    // Copy a string into the arena
+    TextRef store(const std::string& s) {
+        if (blocks.empty() || available - used < s.size()) {
+            // Text longer than a block gets a block of its own
+            available = s.size() > BLOCK_SIZE ? s.size() : BLOCK_SIZE;
+            blocks.push_back(new char[available]);
+            used = 0;
+            ++allocations;
+        }
+        char* p = blocks.back() + used;
+        s.copy(p, s.size());
+        used += s.size();
+        TextRef ref = {p, s.size()};
+        return ref;
+    }
+
+    size_t allocationCount() const {
+        return allocations;
+    }
+};
+
+// All questions kept in a few flat arrays. Strings are numbered in the order
+// they were added: question i owns strings firstString[i] (its text) up to
+// firstString[i + 1] (its options).
+class QuestionStore {
+private:
+    std::vector<QuestionType> types;  // Kind of each question
+    std::vector<int> answers;         // Correct option number of each question
+    std::vector<size_t> firstString;  // First string of each question, plus one past the last
+    std::vector<TextRef> strings;     // Every question and option text
+    TextArena arena;                  // Memory behind the strings
+    size_t arrayAllocations;          // Times one of the arrays above had to grow
+
+    // Append to one of the arrays, counting the times it reallocates
+    template <typename T>
+    void append(std::vector<T>& array, const T& value) {
+        size_t capacity = array.capacity();
+        array.push_back(value);
+        if (array.capacity() != capacity) {
+            ++arrayAllocations;
+        }
+    }
+
+    template <typename T>
+    void reserveArray(std::vector<T>& array, size_t n) {
+        size_t capacity = array.capacity();
+        array.reserve(n);
+        if (array.capacity() != capacity) {
+            ++arrayAllocations;
+        }
+    }
+
+    void addString(const std::string& s) {
+        append(strings, arena.store(s));
+    }
+
+    void printString(size_t s) const {
+        std::cout.write(strings[s].data, strings[s].length);
+        std::cout << std::endl;
+    }
+public:
+    QuestionStore() : arrayAllocations(0) {
+        append(firstString, (size_t)0);
+    }
+
+    // A store owns its texts, so it can be moved but not copied
+    QuestionStore(const QuestionStore&) = delete;
+    QuestionStore& operator=(const QuestionStore&) = delete;
+    QuestionStore(QuestionStore&&) = default;
+
+    // Make room for this many questions and strings, e.g. before a bulk load
+    void reserve(size_t questions, size_t totalStrings) {
+        reserveArray(types, questions);
+        reserveArray(answers, questions);
+        reserveArray(firstString, questions + 1);
+        reserveArray(strings, totalStrings);
+    }
+
+    // Add a multiple-choice question with its options
+    void addMultipleChoice(const std::string& qText, const std::string opts[], int numOpts, int correctAns) {
+        append(types, MULTIPLE_CHOICE);
+        append(answers, correctAns);
+        addString(qText);
+        for (int i = 0; i < numOpts; ++i) {
+            addString(opts[i]);
+        }
+        append(firstString, strings.size());
+    }
+
+    void addMultipleChoice(const std::string& qText, const std::vector<std::string>& opts, int correctAns) {
+        addMultipleChoice(qText, opts.data(), (int)opts.size(), correctAns);
+    }
+
+    // Add a true/false question (1 for True, 2 for False)
+    void addTrueFalse(const std::string& qText, int correctAns) {
+        append(types, TRUE_FALSE);
+        append(answers, correctAns);
+        addString(qText);
+        append(firstString, strings.size());
+    }
+
+    size_t size() const {
+        return types.size();
+    }
+
+    // Heap allocations made for the questions so far
+    size_t allocationCount() const {
+        return arrayAllocations + arena.allocationCount();
+    }
+
+    // Display question i and its options
+    void displayQuestion(size_t i) const {
+        printString(firstString[i]);
+        switch (types[i]) {
+        case MULTIPLE_CHOICE:
+            for (size_t s = firstString[i] + 1; s < firstString[i + 1]; ++s) {
+                std::cout << s - firstString[i] << ". ";
+                printString(s);
+            }
+            break;
+        case TRUE_FALSE:
+            std::cout << "1. True\n2. False" << std::endl;
+            break;
+        }
+    }
+
+    // Every kind is graded by its option number, so no dispatch is needed
+    bool checkAnswer(size_t i, int answer) const {
+        return answer == answers[i];
+    }
+};
+
+#endif
@@ -0,0 +1,189 @@
+// Compares the old Question* hierarchy with the QuestionStore that 2.cpp,
+// Project/2.cpp and Project/3.cpp use (question_store.h): time to load a bank
+// and time to grade answers to it, and the heap allocations the store made.
+//
+// Build:  g++ -O2 question_store_benchmark.cpp -o question_store_benchmark
+// Run:    ./question_store_benchmark [questions] [rounds]
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+#include "question_store.h"
+using namespace std;
+
+const int MAX_OPTIONS = 4;  // Maximum number of options for multiple choice questions
+
+// --- The old hierarchy: one heap object per question, graded through virtual calls ---
+
+class Question {
+protected:
+    string questionText;  // Text of the question
+public:
+    Question(string qText) : questionText(qText) {}
+    virtual void displayQuestion() = 0;
+    virtual bool checkAnswer(int answer) = 0;
+    virtual ~Question() {}
+};
+
+class MultipleChoiceQuestion : public Question {
+private:
+    string options[MAX_OPTIONS];  // Array of multiple-choice options
+    int correctAnswer;            // Index of the correct answer
+    int numOptions;               // Number of options for this question
+public:
+    MultipleChoiceQuestion(string qText, string opts[], int numOpts, int correctAns)
+        : Question(qText), correctAnswer(correctAns), numOptions(numOpts) {
+        for (int i = 0; i < numOptions; ++i) {
+            options[i] = opts[i];
+        }
+    }
+
+    void displayQuestion() override {
+        cout << questionText << endl;
+        for (int i = 0; i < numOptions; ++i) {
+            cout << i + 1 << ". " << options[i] << endl;
+        }
+    }
+
+    bool checkAnswer(int answer) override {
+        return answer == correctAnswer;
+    }
+};
+
+class TrueFalseQuestion : public Question {
+private:
+    int correctAnswer;  // 1 for True, 2 for False
+public:
+    TrueFalseQuestion(string qText, int correctAns)
+        : Question(qText), correctAnswer(correctAns) {}
+
+    void displayQuestion() override {
+        cout << questionText << endl;
+        cout << "1. True\n2. False" << endl;
+    }
+
+    bool checkAnswer(int answer) override {
+        return answer == correctAnswer;
+    }
+};
+
+// --- Benchmark ---
+
+// A question as read from questions.txt
+struct ParsedQuestion {
+    bool isMcq;
+    string text;
+    string options[MAX_OPTIONS];
+    int correctAnswer;
+};
+
+string randomText(mt19937& rng, size_t length) {
+    string s(length, ' ');
+    for (size_t i = 0; i < length; ++i) {
+        s[i] = (char)('a' + rng() % 26);
+    }
+    return s;
+}
+
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void report(const string& name, size_t items, double seconds) {
+    cout << name << ": " << items / seconds / 1e6 << " M/s (" << seconds * 1000 << " ms)" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 10;
+    if (count == 0 || rounds <= 0) {
+        cout << "Usage: question_store_benchmark [questions] [rounds]" << endl;
+        return 1;
+    }
+
+    // Same mix as a typical bank: three MCQ for every TF question
+    mt19937 rng(42);
+    vector<ParsedQuestion> parsed(count);
+    for (size_t i = 0; i < count; ++i) {
+        ParsedQuestion& p = parsed[i];
+        p.isMcq = i % 4 != 3;
+        p.text = randomText(rng, 40 + rng() % 40);
+        for (int o = 0; p.isMcq && o < MAX_OPTIONS; ++o) {
+            p.options[o] = randomText(rng, 5 + rng() % 20);
+        }
+        p.correctAnswer = 1 + (int)(rng() % (p.isMcq ? MAX_OPTIONS : 2));
+    }
+    vector<int> answers(count);
+    for (size_t i = 0; i < count; ++i) {
+        answers[i] = 1 + (int)(rng() % MAX_OPTIONS);
+    }
+    // Students see the questions in a shuffled order
+    vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), rng);
+
+    cout << count << " questions, " << rounds << " grading rounds" << endl;
+
+    // Load
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<Question*> hierarchy;
+    for (size_t i = 0; i < count; ++i) {
+        ParsedQuestion& p = parsed[i];
+        if (p.isMcq) {
+            hierarchy.push_back(new MultipleChoiceQuestion(p.text, p.options, MAX_OPTIONS, p.correctAnswer));
+        } else {
+            hierarchy.push_back(new TrueFalseQuestion(p.text, p.correctAnswer));
+        }
+    }
+    report("load   Question*     ", count, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    QuestionStore store;
+    for (size_t i = 0; i < count; ++i) {
+        ParsedQuestion& p = parsed[i];
+        if (p.isMcq) {
+            store.addMultipleChoice(p.text, p.options, MAX_OPTIONS, p.correctAnswer);
+        } else {
+            store.addTrueFalse(p.text, p.correctAnswer);
+        }
+    }
+    report("load   QuestionStore ", count, secondsSince(start));
+    cout << "allocs QuestionStore: " << store.allocationCount() << " (Question*: " << count
+         << " objects plus their strings)" << endl;
+
+    // Grade
+    long long scoreA = 0, scoreB = 0;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t q = order[i];
+            scoreA += hierarchy[q]->checkAnswer(answers[i]) ? 10 : 0;
+        }
+    }
+    report("grade  Question*     ", count * rounds, secondsSince(start));
+
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t q = order[i];
+            scoreB += store.checkAnswer(q, answers[i]) ? 10 : 0;
+        }
+    }
+    report("grade  QuestionStore ", count * rounds, secondsSince(start));
+
+    if (scoreA != scoreB) {
+        cout << "Scores differ: " << scoreA << " vs " << scoreB << endl;
+        return 1;
+    }
+
+    for (size_t i = 0; i < hierarchy.size(); ++i) {
+        delete hierarchy[i];
+    }
+    return 0;
+}
@@ -0,0 +1,305 @@
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+// Computerized adaptive testing with item response theory.
+//
+// Every question is an item with a difficulty b and a discrimination a, and
+// a student of ability theta answers it right with probability
+//
+//     P = 1 / (1 + exp(-a (theta - b)))      (2PL; 1PL when every a is 1)
+//
+// Difficulties are calibrated from the attempts/correct counts of the
+// question statistics, discriminations from the point-biserials of the item
+// analysis when a question has enough logged answers, and 1 otherwise. After
+// every answer the ability is re-estimated (expected a posteriori over a
+// fixed grid, with a standard normal prior), and the next question is one of
+// the few unused items with the most information a^2 P (1 - P) at the
+// estimate, picked at random so that not every student sees the same items.
+//
+// Picking does not score the whole bank. The items are split into strata by
+// discrimination, and each stratum is sorted by difficulty and cut into
+// buckets of BUCKET_SIZE items. The highest discrimination of its stratum and
+// its distance from theta bound the information of every item in a bucket,
+// and the bound only falls going away from theta, so buckets are visited
+// best bound first and the search stops once no bucket left can beat the
+// items found. That is a few buckets however large the bank is.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+#include "item_analysis.h"
+#include "question_bank.h"
+#include "question_stats.h"
+
+struct AdaptiveItem {
+    float difficulty;
+    float discrimination;
+    uint32_t ordinal;  // Position in the bank
+};
+
+// e^x / (1 + e^x)^2, the slope of the logistic curve
+inline double logisticSlope(double x) {
+    double e = std::exp(-std::fabs(x));
+    return e / ((1 + e) * (1 + e));
+}
+
+inline double itemProbability(double a, double b, double theta) { return 1 / (1 + std::exp(-a * (theta - b))); }
+
+inline double itemInformation(double a, double b, double theta) { return a * a * logisticSlope(a * (theta - b)); }
+
+// --- Calibration ---
+
+const uint64_t ADAPTIVE_MIN_ANSWERS = 30;  // Logged answers before a question's discrimination is trusted
+const double ADAPTIVE_PRIOR_ATTEMPTS = 4;  // Weight of the bank-wide p-value in a question's own
+const double LOGISTIC_SCALE = 1.702;       // Logistic curve ~ normal curve of x / 1.702
+
+// Item parameters of every question in 'bank'. 'stats' are its question
+// statistics and 'analysis', when given, its item analysis.
+//
+// With abilities distributed N(0, 1) a question is answered right by a share
+// p = Phi(-a b / sqrt(1.702^2 + a^2)) of students, which gives b from the
+// question's p-value. The p-value is pulled towards the bank-wide one, so a
+// question with few attempts, or none, is not taken to be extreme. The
+// discrimination comes from the biserial correlation, a = 1.702 r / sqrt(1 - r^2).
+inline std::vector<AdaptiveItem> calibrateItems(const QuestionBank &bank, const std::vector<QuestionStat> &stats,
+                                                const ItemAnalysis *analysis = nullptr) {
+    size_t n = bank.size();
+    std::vector<double> p(n, -1), a(n, 1);
+    uint64_t attempts = 0, correct = 0;
+    for (const QuestionStat &s : stats) {
+        attempts += s.attempts;
+        correct += s.correct;
+    }
+    double bankP = attempts ? (correct + 0.5) / (attempts + 1.0) : 0.5;
+    for (const QuestionStat &s : stats) {
+        size_t ordinal;
+        if (s.attempts > 0 && bank.ordinalOf(s.id, ordinal)) {
+            p[ordinal] = (s.correct + ADAPTIVE_PRIOR_ATTEMPTS * bankP) / (s.attempts + ADAPTIVE_PRIOR_ATTEMPTS);
+        }
+    }
+    if (analysis) {
+        for (const ItemStats &s : analysis->items) {
+            size_t ordinal;
+            if (s.answers < ADAPTIVE_MIN_ANSWERS || !bank.ordinalOf(s.id, ordinal)) continue;
+            double q = std::min(0.99, std::max(0.01, s.difficulty));
+            double z = std::log(q / (1 - q)) / LOGISTIC_SCALE;  // ~ Phi^-1(q)
+            double density = std::exp(-z * z / 2) / 2.5066282746310002;  // Normal density at z
+            double r = std::min(0.95, s.discrimination * std::sqrt(q * (1 - q)) / density);
+            a[ordinal] = std::min(2.5, std::max(0.25, LOGISTIC_SCALE * r / std::sqrt(1 - r * r)));
+        }
+    }
+
+    std::vector<AdaptiveItem> items(n);
+    for (size_t i = 0; i < n; ++i) {
+        double share = std::min(0.995, std::max(0.005, p[i] < 0 ? bankP : p[i]));
+        double z = std::log(share / (1 - share)) / LOGISTIC_SCALE;
+        double b = -z * std::sqrt(LOGISTIC_SCALE * LOGISTIC_SCALE + a[i] * a[i]) / a[i];
+        items[i] = AdaptiveItem{(float)std::min(6.0, std::max(-6.0, b)), (float)a[i], (uint32_t)i};
+    }
+    return items;
+}
+
+// --- Item selection ---
+
+class AdaptiveItemIndex {
+public:
+    static constexpr size_t BUCKET_SIZE = 64;
+    static constexpr size_t MAX_STRATA = 8;
+    static constexpr size_t MAX_CANDIDATES = 16;
+private:
+    struct Bucket {
+        float low, high;        // Difficulty range
+        uint32_t begin, end;    // Items
+    };
+    struct Stratum {
+        size_t begin, end;      // Buckets
+        double discrimination;  // Highest in the stratum
+    };
+    struct Visit {
+        double bound;
+        size_t bucket;
+        const Stratum *stratum;
+        int step;               // Direction to go on in, 0 for both
+        bool operator<(const Visit &o) const { return bound < o.bound; }
+    };
+
+    std::vector<AdaptiveItem> items;  // By stratum, then by difficulty
+    std::vector<Bucket> buckets;
+    std::vector<Stratum> strata;
+
+    // Most information any item with discrimination up to 'a' gives at
+    // 'distance' from its difficulty. That is h(a d) / d^2 with
+    // h(x) = x^2 e^x / (1 + e^x)^2, which rises up to x = 2.3994 and falls
+    // after it.
+    static double informationBound(double a, double distance) {
+        double x = a * distance;
+        if (x <= 2.3994) return a * a * logisticSlope(x);
+        return 0.43923 / (distance * distance);
+    }
+
+    double bucketBound(const Stratum &s, size_t k, double theta) const {
+        const Bucket &b = buckets[k];
+        double distance = theta < b.low ? b.low - theta : theta > b.high ? theta - b.high : 0;
+        return informationBound(s.discrimination, distance);
+    }
+public:
+    void build(std::vector<AdaptiveItem> all) {
+        items = std::move(all);
+        buckets.clear();
+        strata.clear();
+        std::sort(items.begin(), items.end(),
+                  [](const AdaptiveItem &x, const AdaptiveItem &y) { return x.discrimination < y.discrimination; });
+        size_t n = items.size();
+        size_t count = std::max<size_t>(1, std::min(MAX_STRATA, n / (BUCKET_SIZE * 16)));
+        for (size_t s = 0; s < count; ++s) {
+            size_t from = n * s / count, to = n * (s + 1) / count;
+            if (from == to) continue;
+            Stratum stratum = {buckets.size(), buckets.size(), items[to - 1].discrimination};
+            std::sort(items.begin() + from, items.begin() + to,
+                      [](const AdaptiveItem &x, const AdaptiveItem &y) { return x.difficulty < y.difficulty; });
+            for (size_t i = from; i < to; i += BUCKET_SIZE) {
+                size_t last = std::min(to, i + BUCKET_SIZE) - 1;
+                buckets.push_back(Bucket{items[i].difficulty, items[last].difficulty, (uint32_t)i, (uint32_t)last + 1});
+            }
+            stratum.end = buckets.size();
+            strata.push_back(stratum);
+        }
+    }
+
+    size_t size() const { return items.size(); }
+
+    // Pick an item not in 'used' (ordinals) at ability 'theta', at random
+    // among the 'candidates' most informative. False when every item is used.
+    template <class Rng>
+    bool select(double theta, const std::unordered_set<uint32_t> &used, size_t candidates, Rng &rng,
+                AdaptiveItem &picked) const {
+        candidates = std::max<size_t>(1, std::min(candidates, MAX_CANDIDATES));
+        std::pair<double, uint32_t> best[MAX_CANDIDATES];  // Information and index, best first
+        size_t found = 0;
+
+        std::priority_queue<Visit> queue;
+        for (const Stratum &s : strata) {
+            // The bucket holding theta, or the nearest one
+            size_t lo = s.begin, hi = s.end;
+            while (hi - lo > 1) {
+                size_t mid = (lo + hi) / 2;
+                if (buckets[mid].low <= theta) lo = mid;
+                else hi = mid;
+            }
+            queue.push(Visit{bucketBound(s, lo, theta), lo, &s, 0});
+        }
+        while (!queue.empty()) {
+            Visit v = queue.top();
+            queue.pop();
+            if (found == candidates && v.bound <= best[found - 1].first) break;
+
+            const Bucket &b = buckets[v.bucket];
+            for (uint32_t i = b.begin; i < b.end; ++i) {
+                const AdaptiveItem &item = items[i];
+                double info = itemInformation(item.discrimination, item.difficulty, theta);
+                if (found == candidates && info <= best[found - 1].first) continue;
+                if (used.count(item.ordinal)) continue;
+                size_t at = found < candidates ? found++ : found - 1;
+                while (at > 0 && best[at - 1].first < info) {
+                    best[at] = best[at - 1];
+                    --at;
+                }
+                best[at] = {info, i};
+            }
+
+            if (v.step <= 0 && v.bucket > v.stratum->begin) {
+                queue.push(Visit{bucketBound(*v.stratum, v.bucket - 1, theta), v.bucket - 1, v.stratum, -1});
+            }
+            if (v.step >= 0 && v.bucket + 1 < v.stratum->end) {
+                queue.push(Visit{bucketBound(*v.stratum, v.bucket + 1, theta), v.bucket + 1, v.stratum, 1});
+            }
+        }
+        if (found == 0) return false;
+        picked = items[best[std::uniform_int_distribution<size_t>(0, found - 1)(rng)].second];
+        return true;
+    }
+};
+
+// --- Ability estimation ---
+
+class AbilityEstimate {
+public:
+    static constexpr int POINTS = 81;  // Grid over [-4, 4]
+private:
+    double logPosterior[POINTS];
+    double mean = 0;
+    double error = 1;
+
+    static double point(int i) { return -4 + 8.0 * i / (POINTS - 1); }
+public:
+    AbilityEstimate() {
+        for (int i = 0; i < POINTS; ++i) logPosterior[i] = -point(i) * point(i) / 2;
+    }
+
+    void answer(const AdaptiveItem &item, bool correct) {
+        double top = -INFINITY;
+        for (int i = 0; i < POINTS; ++i) {
+            double p = itemProbability(item.discrimination, item.difficulty, point(i));
+            logPosterior[i] += std::log(std::max(1e-300, correct ? p : 1 - p));
+            top = std::max(top, logPosterior[i]);
+        }
+        double weight = 0, sum = 0, squares = 0;
+        for (int i = 0; i < POINTS; ++i) {
+            double w = std::exp(logPosterior[i] - top);
+            weight += w;
+            sum += w * point(i);
+            squares += w * point(i) * point(i);
+        }
+        mean = sum / weight;
+        error = std::sqrt(std::max(0.0, squares / weight - mean * mean));
+    }
+
+    double theta() const { return mean; }
+    double standardError() const { return error; }
+};
+
+// --- Sessions ---
+
+struct AdaptiveConfig {
+    size_t maxItems = 20;
+    size_t minItems = 5;         // Asked before targetError may end the test
+    double targetError = 0.3;    // Stop once the ability is known this well
+    size_t candidates = 5;       // Best items the next one is drawn from
+};
+
+// One student's test: next() the item to ask, answer() how it went
+class AdaptiveSession {
+private:
+    const AdaptiveItemIndex &index;
+    AdaptiveConfig config;
+    AbilityEstimate ability;
+    std::unordered_set<uint32_t> used;
+    AdaptiveItem current = {};
+    std::mt19937_64 rng;
+public:
+    AdaptiveSession(const AdaptiveItemIndex &itemIndex, const AdaptiveConfig &c, uint64_t seed)
+        : index(itemIndex), config(c), rng(seed) {}
+
+    // The next item to ask, or false when the test is over
+    bool next(AdaptiveItem &item) {
+        if (used.size() >= config.maxItems) return false;
+        if (used.size() >= config.minItems && ability.standardError() <= config.targetError) return false;
+        if (!index.select(ability.theta(), used, config.candidates, rng, current)) return false;
+        used.insert(current.ordinal);
+        item = current;
+        return true;
+    }
+
+    void answer(bool correct) { ability.answer(current, correct); }
+
+    size_t asked() const { return used.size(); }
+    double theta() const { return ability.theta(); }
+    double standardError() const { return ability.standardError(); }
+};
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef BANK_CACHE_H
+#define BANK_CACHE_H
+
+// In-memory cache of the question bank.
+//
+// The loaded bank is kept as an immutable snapshot. A quiz takes the current
+// snapshot when it starts and holds on to it, so a quiz in progress never
+// sees its questions change. When questions.txt changes, the next snapshot
+// is built on the side and published in place of the old one, which is freed
+// when the last quiz holding it finishes (read-copy-update). Taking the
+// current snapshot is an atomic shared_ptr load; only a reload takes a lock.
+//
+// Changes are noticed through inotify where it is available, otherwise by
+// comparing the size and modification time of questions.txt on every call.
+// questions.txt is normally only appended to, so when it has grown and its
+// old bytes still hash the same, only the new records are parsed and added
+// to a copy of the old snapshot. Anything else (an edit by hand, a file
+// replaced) loads the bank afresh, from the compiled bank if that is up to
+// date. Either way a snapshot holds exactly the records before source.size.
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "platform.h"
+#include "question_bank.h"
+#include "trace.h"
+
+// One version of the bank, never changed once published
+struct BankSnapshot {
+    QuestionBank bank;
+    FileInfo source;           // questions.txt as this version read it
+    uint64_t textHash = 0;     // FNV-1a hash of those bytes, to tell an append from an edit
+    uint64_t version = 0;      // 1 for the first load, one more for each reload
+    bool incremental = false;  // Built from the previous version plus appended records
+};
+
+class BankCache {
+private:
+    std::string textPath, compiledPath;
+    std::shared_ptr<const BankSnapshot> current;  // Only touched through std::atomic_load/atomic_store
+    std::mutex reloadLock;                        // Held while the next snapshot is built
+    FileWatcher watcher;
+    std::atomic<bool> stale{true};
+
+    static constexpr uint64_t HASH_START = 14695981039346656037ull;
+
+    // Go on with the 64-bit FNV-1a hash 'h' over bytes [from, to) of the file
+    static bool hashText(const std::string &path, uint64_t from, uint64_t to, uint64_t &h) {
+        if (from >= to) return true;
+        MappedFile file;
+        if (!file.open(path) || file.size() < to) return false;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(file.data());
+        for (uint64_t i = from; i < to; ++i) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return true;
+    }
+
+    std::shared_ptr<BankSnapshot> build(const std::shared_ptr<const BankSnapshot> &old) {
+        TRACE_SPAN(TRACE_PARSE);
+        std::shared_ptr<BankSnapshot> next = std::make_shared<BankSnapshot>();
+        next->source = snapshotBank(textPath);
+        if (!next->source.exists) return nullptr;
+        next->version = old ? old->version + 1 : 1;
+
+        uint64_t h = HASH_START, hashed = 0;  // Hash of bytes [0, hashed)
+        if (old && next->source.size > old->source.size && hashText(textPath, 0, old->source.size, h) &&
+            h == old->textHash) {
+            // Records were appended: keep the old questions and parse only the new ones
+            BankBuilder builder;
+            old->bank.copyTo(builder);
+            if (!QuestionBank::parseText(textPath, builder, next->source.size, old->source.size)) return nullptr;
+            next->bank.adopt(builder, next->source);
+            next->incremental = true;
+            hashed = old->source.size;
+        } else {
+            h = HASH_START;
+            if (!next->bank.load(textPath, compiledPath, next->source)) return nullptr;
+        }
+        if (!hashText(textPath, hashed, next->source.size, h)) return nullptr;
+        next->textHash = h;
+        return next;
+    }
+
+    void reload() {
+        std::lock_guard<std::mutex> lock(reloadLock);
+        if (!stale.exchange(false)) return;  // Another thread got here first
+        std::shared_ptr<const BankSnapshot> old = std::atomic_load(&current);
+        FileInfo now = snapshotBank(textPath);
+        if (old && now.size == old->source.size && now.mtime == old->source.mtime) return;
+
+        std::shared_ptr<const BankSnapshot> next = build(old);
+        if (next) {
+            std::atomic_store(&current, next);
+        } else {
+            stale = true;  // Mid-rewrite or unreadable: keep serving the old version and try again next time
+        }
+    }
+public:
+    BankCache(const std::string &text, const std::string &compiled) : textPath(text), compiledPath(compiled) {
+        watcher.watch(textPath);
+    }
+
+    BankCache(const BankCache &) = delete;
+    BankCache &operator=(const BankCache &) = delete;
+
+    // Whether a version of the bank has been loaded yet; loads nothing
+    bool isLoaded() const { return (bool)std::atomic_load(&current); }
+
+    // The newest version of the bank, reloaded first if questions.txt has
+    // changed. Null if the bank could never be read.
+    std::shared_ptr<const BankSnapshot> snapshot() {
+        if (watcher.isWatching()) {
+            if (watcher.changed()) stale = true;
+        } else {
+            std::shared_ptr<const BankSnapshot> snap = std::atomic_load(&current);
+            FileInfo now = getFileInfo(textPath);
+            if (!snap || now.size != snap->source.size || now.mtime != snap->source.mtime) stale = true;
+        }
+        if (stale) reload();
+        return std::atomic_load(&current);
+    }
+};
+
+#endif
@@ -0,0 +1,493 @@
+// Benchmarks for the quiz engine's hot paths on synthetic data.
+//
+// Build:  make benchmark
+// Run:    ./benchmark --questions 1000000 --out results.json
+//
+// Every operation reports throughput and p50/p99 latency. Results are also
+// written as JSON so two versions can be compared run against run.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include "adaptive.h"
+#include "bank_cache.h"
+#include "console.h"
+#include "grader.h"
+#include "item_analysis.h"
+#include "leaderboard.h"
+#include "platform.h"
+#include "question_bank.h"
+#include "question_kinds.h"
+#include "question_stats.h"
+#include "result_log.h"
+#include "workload.h"
+using namespace std;
+
+struct BenchmarkResult {
+    string name;
+    size_t items;     // Units of work done (questions, rows, answers...)
+    double seconds;   // Total time over all calls
+    double p50;       // Latency of one call in microseconds
+    double p99;
+};
+
+struct BenchmarkOptions {
+    WorkloadConfig workload;
+    size_t ops = 100000;    // Calls for per-call operations
+    size_t repeat = 5;      // Runs of whole-file operations
+    size_t sheets = 10000;  // Answer sheets to grade
+    size_t adaptiveItems = 1000000;  // Items to pick adaptive quiz questions from
+    string dir = "bench_data";
+    string out = "bench_results.json";
+    string label = "current";
+    bool generate = true;
+};
+
+vector<BenchmarkResult> results;
+
+// The Question classes final.cpp used before questions became flat records:
+// one heap object per question, shown and checked through virtual calls.
+// The baseline for the question shapes in question_kinds.h.
+class LegacyQuestion {
+protected:
+    string questionText;
+public:
+    LegacyQuestion(string qText) : questionText(qText) {}
+    virtual void displayQuestion(ostream &out) = 0;
+    virtual bool checkAnswer(int answer) = 0;
+    virtual ~LegacyQuestion() {}
+};
+
+class LegacyMultipleChoiceQuestion : public LegacyQuestion {
+private:
+    string options[MAX_OPTIONS];
+    int correctAnswer;
+    int numOptions;
+public:
+    LegacyMultipleChoiceQuestion(string qText, const string opts[], int numOpts, int correctAns)
+        : LegacyQuestion(qText), correctAnswer(correctAns), numOptions(numOpts) {
+        for (int i = 0; i < numOptions; ++i) options[i] = opts[i];
+    }
+    void displayQuestion(ostream &out) override {
+        out << questionText << "\n";
+        for (int i = 0; i < numOptions; ++i) out << i + 1 << ". " << options[i] << "\n";
+    }
+    bool checkAnswer(int answer) override { return answer == correctAnswer; }
+};
+
+class LegacyTrueFalseQuestion : public LegacyQuestion {
+private:
+    int correctAnswer;
+public:
+    LegacyTrueFalseQuestion(string qText, int correctAns) : LegacyQuestion(qText), correctAnswer(correctAns) {}
+    void displayQuestion(ostream &out) override { out << questionText << "\n1. True\n2. False\n"; }
+    bool checkAnswer(int answer) override { return answer == correctAnswer; }
+};
+
+// Time 'calls' calls of op(i); each call does itemsPerCall units of work
+void measure(const string &name, size_t calls, size_t itemsPerCall, const function<void(size_t)> &op,
+             const function<void()> &finish = nullptr) {
+    LatencySamples samples;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+        chrono::steady_clock::time_point t = chrono::steady_clock::now();
+        op(i);
+        samples.add((double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t).count());
+    }
+    if (finish) finish();  // Work deferred by the calls, such as a final flush
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    results.push_back({name, calls * itemsPerCall, seconds, samples.percentile(50) / 1000, samples.percentile(99) / 1000});
+
+    const BenchmarkResult &r = results.back();
+    cout << left << setw(24) << r.name << right << setw(12) << r.items
+         << setw(14) << fixed << setprecision(0) << (r.seconds > 0 ? r.items / r.seconds : 0)
+         << setw(12) << setprecision(2) << r.p50 << setw(12) << r.p99 << endl;
+}
+
+string jsonString(const string &s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+bool writeResults(const BenchmarkOptions &o) {
+    ofstream file(o.out);
+    if (!file.is_open()) return false;
+    const WorkloadConfig &w = o.workload;
+    file << fixed << "{\n  \"label\": " << jsonString(o.label) << ",\n"
+         << "  \"config\": {\"questions\": " << w.questions << ", \"mcq_ratio\": " << setprecision(3) << w.mcqRatio
+         << ", \"text_length\": " << w.textLength << ", \"leaderboard_rows\": " << w.leaderboardRows
+         << ", \"stats_entries\": " << w.statsEntries << ", \"ops\": " << o.ops << ", \"repeat\": " << o.repeat
+         << ", \"sheets\": " << o.sheets << ", \"seed\": " << w.seed << "},\n"
+         << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchmarkResult &r = results[i];
+        file << "    {\"name\": " << jsonString(r.name) << ", \"items\": " << r.items
+             << ", \"seconds\": " << setprecision(6) << r.seconds
+             << ", \"items_per_sec\": " << setprecision(1) << (r.seconds > 0 ? r.items / r.seconds : 0)
+             << ", \"p50_us\": " << setprecision(3) << r.p50 << ", \"p99_us\": " << r.p99 << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return (bool)file;
+}
+
+void usage() {
+    cout << "Usage: benchmark [options]\n"
+         << "  --questions N         questions in the synthetic bank (default 100000)\n"
+         << "  --mcq-ratio R         share of MCQ questions, 0 to 1 (default 0.75)\n"
+         << "  --text-length N       average question text length (default 60)\n"
+         << "  --leaderboard-rows N  rows in the synthetic leaderboard (default 100000)\n"
+         << "  --stats-entries N     questions with existing statistics (default 100000)\n"
+         << "  --responses N         logged answers for item analysis (default 2000000)\n"
+         << "  --ops N               calls for per-call operations (default 100000)\n"
+         << "  --repeat N            runs of whole-file operations (default 5)\n"
+         << "  --sheets N            answer sheets to grade (default 10000)\n"
+         << "  --adaptive-items N    items to pick adaptive quiz questions from (default 1000000)\n"
+         << "  --seed N              random seed (default 42)\n"
+         << "  --dir PATH            where the data files go (default bench_data)\n"
+         << "  --out PATH            JSON results file (default bench_results.json)\n"
+         << "  --label NAME          name of this run in the results (default current)\n"
+         << "  --reuse               use the data files left by an earlier run\n";
+}
+
+bool parseOptions(int argc, char *argv[], BenchmarkOptions &o) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--reuse") {
+            o.generate = false;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        string value = argv[++i];
+        WorkloadConfig &w = o.workload;
+        if (arg == "--questions") w.questions = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--mcq-ratio") w.mcqRatio = atof(value.c_str());
+        else if (arg == "--text-length") w.textLength = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--leaderboard-rows") w.leaderboardRows = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--stats-entries") w.statsEntries = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--responses") w.responses = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--ops") o.ops = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--repeat") o.repeat = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--sheets") o.sheets = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--adaptive-items") o.adaptiveItems = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--seed") w.seed = strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--dir") o.dir = value;
+        else if (arg == "--out") o.out = value;
+        else if (arg == "--label") o.label = value;
+        else return false;
+    }
+    return o.workload.mcqRatio >= 0 && o.workload.mcqRatio <= 1 && o.ops > 0 && o.repeat > 0;
+}
+
+int main(int argc, char *argv[]) {
+    BenchmarkOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        usage();
+        return 1;
+    }
+
+    string questions = o.dir + "/questions.txt";
+    string compiled = o.dir + "/questions.bin";
+    string index = o.dir + "/questions.idx";
+    string stats = o.dir + "/question_stats.dat";
+    string responses = o.dir + "/responses.dat";
+    string leaderboard = o.dir + "/leaderboard.txt";
+    string leaderboardIndex = o.dir + "/leaderboard.idx";
+    string sheets = o.dir + "/answer_sheets.txt";
+    string scratch = o.dir + "/scratch.txt";
+
+    if (o.generate) {
+        cout << "Generating data in " << o.dir << "..." << endl;
+        if (!makeDirectory(o.dir) || !generateQuestionBank(questions, o.workload) ||
+            !generateLeaderboard(leaderboard, o.workload) || !generateStats(stats, o.workload) ||
+            (o.workload.responses > 0 && !generateResponses(responses, o.workload.questions, o.workload))) {
+            cout << "Unable to write the data files!" << endl;
+            return 1;
+        }
+    }
+
+    mt19937_64 rng(o.workload.seed);
+    cout << left << setw(24) << "operation" << right << setw(12) << "items" << setw(14) << "items/s"
+         << setw(12) << "p50 us" << setw(12) << "p99 us" << endl;
+
+    // Question loading
+    size_t n = 0;
+    measure("load_text", o.repeat, o.workload.questions, [&](size_t) {
+        QuestionBank bank;
+        bank.load(questions, "");
+        n = bank.size();
+    });
+    if (n == 0) {
+        cout << "The question bank is empty." << endl;
+        return 1;
+    }
+    // The same on one core, to see how loading scales
+    measure("load_text_1core", o.repeat, o.workload.questions, [&](size_t) {
+        QuestionBank bank;
+        bank.load(questions, "", 1);
+    });
+    // The parser alone, counted in bytes: map questions.txt and walk every record
+    size_t parsed = 0;
+    measure("parse_mapped_bytes", o.repeat, (size_t)getFileInfo(questions).size, [&](size_t) {
+        MappedFile file;
+        file.open(questions);
+        QuestionTextParser parser(file.data(), file.size());
+        QuestionRecord q;
+        parsed = 0;
+        while (parser.next(q)) parsed++;
+    });
+    if (parsed != n) {
+        cout << "The parser found " << parsed << " questions, the loader " << n << "." << endl;
+        return 1;
+    }
+    measure("compile", o.repeat, n, [&](size_t) { QuestionBank::compile(questions, compiled); });
+    measure("load_compiled", o.repeat, n, [&](size_t) {
+        QuestionBank bank;
+        bank.load(questions, compiled);
+    });
+    vector<uint64_t> offsets;
+    measure("index_build", o.repeat, n, [&](size_t) { QuestionIndex::build(questions, index, offsets); });
+
+    QuestionIndex byIndex;
+    byIndex.open(questions, index);
+    vector<size_t> ordinals(o.ops);
+    for (size_t &i : ordinals) i = uniform_int_distribution<size_t>(0, n - 1)(rng);
+    QuestionRecord fetched;
+    measure("index_fetch", o.ops, 1, [&](size_t i) { byIndex.fetch(ordinals[i], fetched); });
+
+    // Cached bank: checking for changes, and picking up one appended question
+    string cachedQuestions = o.dir + "/cache_questions.txt";
+    {
+        ifstream in(questions, ios::binary);
+        ofstream out(cachedQuestions, ios::binary | ios::trunc);
+        out << in.rdbuf();
+    }
+    string cachedIndex = o.dir + "/cache_questions.idx";
+    vector<uint64_t> cachedOffsets;
+    QuestionIndex::build(cachedQuestions, cachedIndex, cachedOffsets);
+    BankCache cache(cachedQuestions, "");
+    cache.snapshot();
+    measure("cache_snapshot", o.ops, 1, [&](size_t) { cache.snapshot(); });
+    measure("cache_append_reload", o.repeat, 1, [&](size_t i) {
+        appendQuestionRecord(cachedQuestions, cachedIndex, "TF\nAppended question " + to_string(i) + "\n1\n");
+        cache.snapshot();
+    });
+
+    // Grading, as askQuestion checks an answer
+    QuestionBank bank;
+    bank.load(questions, compiled);
+    vector<string> answers(o.ops);
+    for (string &a : answers) a = to_string(uniform_int_distribution<int>(1, MAX_OPTIONS)(rng));
+    size_t correct = 0;
+    measure("grade_answer", o.ops, 1, [&](size_t i) {
+        correct += checkQuestionAnswer(bank.question(ordinals[i]), ConsoleInput::parseInt(answers[i]));
+    });
+
+    // Checking and showing questions: the old virtual classes against the
+    // question shapes, on the same questions in the same order. Batches of
+    // QUESTION_BATCH per call keep the clock out of the per-answer time.
+    const size_t QUESTION_BATCH = 1000;
+    size_t batches = max<size_t>(1, o.ops / QUESTION_BATCH);
+    vector<QuestionRecord> records(bank.size());
+    vector<unique_ptr<LegacyQuestion>> legacy(bank.size());
+    for (size_t i = 0; i < bank.size(); ++i) {
+        const QuestionRecord &q = records[i] = bank.question(i);
+        if (q.type == QUESTION_TF) {
+            legacy[i].reset(new LegacyTrueFalseQuestion(string(q.text), q.correctAnswer));
+        } else {
+            string opts[MAX_OPTIONS];
+            for (int j = 0; j < q.numOptions; ++j) opts[j] = string(q.options[j]);
+            legacy[i].reset(new LegacyMultipleChoiceQuestion(string(q.text), opts, q.numOptions, q.correctAnswer));
+        }
+    }
+    vector<int> choices(batches * QUESTION_BATCH);
+    vector<size_t> picks(choices.size());
+    for (size_t i = 0; i < choices.size(); ++i) {
+        choices[i] = uniform_int_distribution<int>(1, MAX_OPTIONS)(rng);
+        picks[i] = uniform_int_distribution<size_t>(0, bank.size() - 1)(rng);
+    }
+    measure("check_answer_virtual", batches, QUESTION_BATCH, [&](size_t b) {
+        for (size_t i = b * QUESTION_BATCH; i < (b + 1) * QUESTION_BATCH; ++i) {
+            correct += legacy[picks[i]]->checkAnswer(choices[i]);
+        }
+    });
+    measure("check_answer_shape", batches, QUESTION_BATCH, [&](size_t b) {
+        for (size_t i = b * QUESTION_BATCH; i < (b + 1) * QUESTION_BATCH; ++i) {
+            correct += checkQuestionAnswer(records[picks[i]], choices[i]);
+        }
+    });
+    size_t shownBytes = 0;
+    measure("render_virtual", batches, QUESTION_BATCH, [&](size_t b) {
+        for (size_t i = b * QUESTION_BATCH; i < (b + 1) * QUESTION_BATCH; ++i) {
+            ostringstream out;
+            legacy[picks[i]]->displayQuestion(out);
+            shownBytes += out.str().size();
+        }
+    });
+    string shown;
+    measure("render_shape", batches, QUESTION_BATCH, [&](size_t b) {
+        for (size_t i = b * QUESTION_BATCH; i < (b + 1) * QUESTION_BATCH; ++i) {
+            shown.clear();
+            renderQuestion(shown, records[picks[i]]);
+            shownBytes += shown.size();
+        }
+    });
+    legacy.clear();
+    if (shownBytes == 0) cout << "Nothing rendered\n";
+
+    if (o.sheets > 0) {
+        QuestionBank sheetBank;  // Sheets answer every question, so keep them short
+        WorkloadConfig small = o.workload;
+        small.questions = min<size_t>(n, 50);
+        string smallQuestions = o.dir + "/sheet_questions.txt";
+        if (o.generate) generateQuestionBank(smallQuestions, small);
+        sheetBank.load(smallQuestions, "");
+        if (o.generate) generateAnswerSheets(sheets, sheetBank, o.sheets, o.workload);
+        GradingResult graded;
+        measure("grade_sheets", o.repeat, o.sheets, [&](size_t) { gradeSheets(sheetBank, sheets, graded); });
+
+        // As "final --grade" does it: each stretch of sheets saved through the result log
+        string scratchLog = o.dir + "/scratch.wal";
+        remove(scratch.c_str());
+        remove(scratchLog.c_str());
+        ResultLog log(32, chrono::milliseconds(0), 256);
+        if (log.open(scratchLog, scratch)) {
+            measure("grade_sheets_saved", o.repeat, o.sheets, [&](size_t) {
+                gradeSheets(sheetBank, sheets, graded, 0, true,
+                            [&](const GradingResult &batch) { return log.append(batch.results); });
+            });
+        }
+        remove(scratch.c_str());
+    }
+
+    // Question statistics
+    {
+        QuestionStatsStore store;
+        store.open(stats);
+        measure("stats_record", o.ops, 1, [&](size_t i) { store.record((uint32_t)ordinals[i] + 1, i % 2); });
+        StatsWriter writer(store, chrono::milliseconds(500));
+        measure("stats_writer_record", o.ops, 1, [&](size_t i) { writer.record((uint32_t)ordinals[i] + 1, i % 2); },
+                [&] { writer.flush(); });
+        // Many sessions answering the same few popular questions at once
+        const size_t sessions = 8;
+        measure("stats_writer_8threads", 1, o.ops, [&](size_t) {
+            vector<thread> threads;
+            for (size_t t = 0; t < sessions; ++t) {
+                threads.emplace_back([&, t] {
+                    for (size_t i = t; i < o.ops; i += sessions) writer.record((uint32_t)(i % 8) + 1, i % 2);
+                });
+            }
+            for (thread &th : threads) th.join();
+        }, [&] { writer.flush(); });
+        // Rewriting the store while the writer goes on recording answers
+        measure("stats_compact", o.repeat, store.all().size(), [&](size_t i) {
+            writer.record((uint32_t)ordinals[i % ordinals.size()] + 1, true);
+            QuestionStatsStore::compact(stats, nullptr, nullptr, true);
+        });
+    }
+
+    // Item analysis over the response log
+    if (o.workload.responses > 0) {
+        ItemAnalysis analysis;
+        measure("item_analysis", o.repeat, o.workload.responses, [&](size_t) { analyseResponses(responses, analysis); });
+        measure("item_analysis_1core", o.repeat, o.workload.responses,
+                [&](size_t) { analyseResponses(responses, analysis, 1); });
+    }
+
+    // Adaptive quizzes: calibrating the bank from its statistics and item
+    // analysis, then picking questions from a bank of --adaptive-items items
+    {
+        QuestionStatsStore store;
+        store.open(stats);
+        vector<QuestionStat> counts = store.all();
+        ItemAnalysis analysis;
+        analyseResponses(responses, analysis);
+        AdaptiveItemIndex calibrated;
+        measure("adaptive_calibrate", o.repeat, bank.size(),
+                [&](size_t) { calibrated.build(calibrateItems(bank, counts, &analysis)); });
+    }
+    if (o.adaptiveItems > 0) {
+        vector<AdaptiveItem> items(o.adaptiveItems);
+        normal_distribution<double> normal(0, 1);
+        lognormal_distribution<double> spread(0, 0.35);
+        for (size_t i = 0; i < items.size(); ++i) {
+            items[i] = AdaptiveItem{(float)normal(rng), (float)min(2.5, max(0.25, spread(rng))), (uint32_t)i};
+        }
+        AdaptiveItemIndex index;
+        measure("adaptive_index_build", o.repeat, items.size(), [&](size_t) { index.build(items); });
+
+        // One call is one question of a simulated student's quiz
+        AdaptiveConfig config;
+        unique_ptr<AdaptiveSession> session;
+        double ability = 0;
+        uniform_real_distribution<double> chance(0, 1);
+        measure("adaptive_select", o.ops, 1, [&](size_t i) {
+            AdaptiveItem item = {};
+            if (!session || !session->next(item)) {
+                session.reset(new AdaptiveSession(index, config, o.workload.seed + i));
+                ability = normal(rng);
+                session->next(item);
+            }
+            session->answer(chance(rng) < itemProbability(item.discrimination, item.difficulty, ability));
+        });
+    }
+
+    // Leaderboard
+    remove(scratch.c_str());
+    {
+        // As Student::saveToLeaderboard saves a result: one student at a
+        // time, so every result waits for its own fsync
+        string scratchLog = o.dir + "/scratch.wal";
+        remove(scratchLog.c_str());
+        ResultLog log(32, chrono::milliseconds(0), 256);
+        if (log.open(scratchLog, scratch)) {
+            measure("result_log_append", min<size_t>(o.ops, 1000), 1,
+                    [&](size_t i) { log.append("Student", (int)i, (int)(i % 21) * 10); });
+        }
+    }
+    remove(scratch.c_str());
+
+    remove(leaderboardIndex.c_str());
+    measure("leaderboard_index_build", 1, o.workload.leaderboardRows, [&](size_t) {
+        Leaderboard board;
+        board.open(leaderboard, leaderboardIndex);
+    });
+    measure("leaderboard_open", o.repeat, 1, [&](size_t) {
+        Leaderboard board;
+        board.open(leaderboard, leaderboardIndex);
+    });
+
+    Leaderboard board;
+    board.open(leaderboard, leaderboardIndex);
+    if (board.size() > 0) {
+        vector<size_t> starts(o.ops);
+        for (size_t &s : starts) s = uniform_int_distribution<size_t>(0, board.size() - 1)(rng);
+        size_t shown = 0;
+        measure("leaderboard_top10", o.ops, 1, [&](size_t) { shown += board.top(10).size(); });
+        measure("leaderboard_page", o.ops, 1, [&](size_t i) { shown += board.page(starts[i], 10).size(); });
+        uniform_int_distribution<int> student(1, (int)max<size_t>(1, o.workload.students));
+        size_t rank;
+        int best;
+        measure("leaderboard_rank", o.ops, 1, [&](size_t) { board.rankOf(student(rng), rank, best); });
+    }
+
+    if (!writeResults(o)) {
+        cout << "Unable to write " << o.out << endl;
+        return 1;
+    }
+    cout << "Results written to " << o.out << endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+using namespace std;
+
+#ifdef _WIN32
+
+int main() {
+    cout << "The quiz client is only available on Linux.\n";
+    return 1;
+}
+
+#else
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Thin terminal for the quiz server ("final --server"): everything the server
+// sends is printed as is, and every line typed is sent to the server.
+//
+// Usage: client [socket path | port]   (default: quiz.sock)
+
+// Connect to a loopback TCP port if the argument is a number, otherwise to a Unix socket path
+int connectToServer(const string &target) {
+    bool isPort = !target.empty() && target.find_first_not_of("0123456789") == string::npos;
+    if (isPort) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)stoi(target));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (target.size() >= sizeof(addr.sun_path)) return -1;
+    memcpy(addr.sun_path, target.c_str(), target.size() + 1);
+    if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+// Write all of buf, retrying short writes
+bool writeAll(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) return false;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    string target = argc > 1 ? argv[1] : "quiz.sock";
+    int fd = connectToServer(target);
+    if (fd < 0) {
+        cout << "Unable to connect to the quiz server at " << target << "!\n";
+        return 1;
+    }
+
+    pollfd fds[2] = {{fd, POLLIN, 0}, {0, POLLIN, 0}};
+    char buf[4096];
+    bool stdinOpen = true;
+
+    while (true) {
+        int ready = poll(fds, stdinOpen ? 2 : 1, -1);
+        if (ready < 0) continue;
+
+        // Server output goes straight to the terminal
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) break;  // Server closed the session
+            writeAll(1, buf, (size_t)n);
+        }
+
+        // Typed lines go to the server
+        if (stdinOpen && (fds[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t n = read(0, buf, sizeof(buf));
+            if (n > 0) {
+                if (!writeAll(fd, buf, (size_t)n)) break;
+            } else {
+                stdinOpen = false;
+                shutdown(fd, SHUT_WR);  // Server finishes what was sent, then closes
+            }
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+// Line input from the terminal with an optional deadline.
+//
+// The reader waits in poll() until a line arrives or the deadline passes, so
+// no CPU is used while a student is thinking. Deadlines use steady_clock and
+// are not affected by changes to the wall clock. All input goes through one
+// reader, because mixing it with cin would lose whatever cin had buffered.
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+enum InputStatus { INPUT_OK, INPUT_TIMEOUT, INPUT_EOF };
+
+class ConsoleInput {
+private:
+    int fd;
+    std::string buffer;  // Bytes read but not yet returned as a line
+    bool atEof = false;
+
+    bool takeLine(std::string &line) {
+        size_t end = buffer.find('\n');
+        if (end == std::string::npos) return false;
+        line.assign(buffer, 0, end);
+        buffer.erase(0, end + 1);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        return true;
+    }
+
+    InputStatus readLineUntil(std::string &line, const std::chrono::steady_clock::time_point *deadline) {
+        std::cout.flush();  // The prompt must be visible before we block
+#ifdef _WIN32
+        // Windows consoles cannot be polled for a complete line, so the read
+        // blocks and an answer that arrives after the deadline counts as late.
+        (void)fd;
+        if (!std::getline(std::cin, line)) return INPUT_EOF;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (deadline && std::chrono::steady_clock::now() > *deadline) return INPUT_TIMEOUT;
+        return INPUT_OK;
+#else
+        while (true) {
+            if (takeLine(line)) return INPUT_OK;
+            if (atEof) {
+                if (buffer.empty()) return INPUT_EOF;
+                line.swap(buffer);  // Last line without a newline
+                buffer.clear();
+                return INPUT_OK;
+            }
+
+            int timeoutMs = -1;
+            if (deadline) {
+                auto left = *deadline - std::chrono::steady_clock::now();
+                if (left <= std::chrono::steady_clock::duration::zero()) return INPUT_TIMEOUT;
+                timeoutMs = (int)std::chrono::ceil<std::chrono::milliseconds>(left).count();
+            }
+
+            pollfd p = {fd, POLLIN, 0};
+            int ready = poll(&p, 1, timeoutMs);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                atEof = true;
+                continue;
+            }
+            if (ready == 0) continue;  // Woke at the deadline, checked at the top of the loop
+
+            char chunk[4096];
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n > 0) {
+                buffer.append(chunk, (size_t)n);
+            } else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+                atEof = true;
+            }
+        }
+#endif
+    }
+public:
+    explicit ConsoleInput(int inputFd = 0) : fd(inputFd) {}
+
+    // Wait as long as it takes for the next line
+    InputStatus readLine(std::string &line) {
+        return readLineUntil(line, nullptr);
+    }
+
+    // Wait for the next line until the deadline
+    InputStatus readLine(std::string &line, std::chrono::steady_clock::time_point deadline) {
+        return readLineUntil(line, &deadline);
+    }
+
+    // Read a line holding a number. value is -1 if the line is not a number.
+    InputStatus readInt(int &value) {
+        std::string line;
+        InputStatus status = readLine(line);
+        value = status == INPUT_OK ? parseInt(line) : -1;
+        return status;
+    }
+
+    static int parseInt(const std::string &line) {
+        const char *start = line.c_str();
+        char *end;
+        long v = std::strtol(start, &end, 10);
+        while (*end == ' ' || *end == '\t') ++end;
+        if (end == start || *end != '\0' || v < 0 || v > 1000000000L) return -1;
+        return (int)v;
+    }
+
+    // Throw away an answer typed too late, so it is not taken as the answer
+    // to the next question. Only a terminal can have such input; a pipe or
+    // file holds real answers for the following questions.
+    void discardLateInput() {
+#ifndef _WIN32
+        if (isatty(fd)) {
+            buffer.clear();
+            tcflush(fd, TCIFLUSH);
+        }
+#endif
+    }
+};
+
+#endif
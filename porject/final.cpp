@@ -2,11 +2,53 @@
 #include <fstream>
 #include <string>
 #include <iomanip>
-#include <ctime>  // For tracking quiz time
+#include <memory>
+#include <mutex>
+#include <chrono>  // For per-question deadlines
+#include <cstdlib>
+#include <sstream>
+#include <random>
+#include <vector>
+#include "adaptive.h"
+#include "bank_cache.h"
+#include "console.h"
+#include "grader.h"
+#include "item_analysis.h"
+#include "leaderboard.h"
+#include "menu.h"
+#include "question_bank.h"
+#include "question_import.h"
+#include "question_kinds.h"
+#include "question_stats.h"
+#include "response_log.h"
+#include "result_log.h"
+#include "screen.h"
+#include "server.h"
+#include "trace.h"
 using namespace std;
 
-const int MAX_OPTIONS = 4;
 const int TIME_LIMIT = 10; // Set a time limit of 10 seconds per question
+const string QUESTIONS_FILE = "questions.txt";
+const string COMPILED_QUESTIONS_FILE = "questions.bin";  // Built from QUESTIONS_FILE by "Compile Question Bank"
+const string QUESTIONS_INDEX_FILE = "questions.idx";     // Offset of every record in QUESTIONS_FILE
+const string STATS_FILE = "question_stats.dat";
+const string OLD_STATS_FILE = "question_stats.txt";      // Text format used before STATS_FILE, migrated on first use
+const string LEADERBOARD_FILE = "leaderboard.txt";
+const string LEADERBOARD_INDEX_FILE = "leaderboard.idx";  // Sorted index over LEADERBOARD_FILE
+const string RESULT_LOG_FILE = "leaderboard.wal";         // Results not yet moved into LEADERBOARD_FILE
+const string RESPONSE_LOG_FILE = "responses.dat";         // Every answer given, for item analysis
+const string ITEM_ANALYSIS_FILE = "item_analysis.csv";    // Exported by "View Question Statistics"
+const size_t LEADERBOARD_PAGE_SIZE = 10;
+const int STATS_WRITE_INTERVAL_MS = 500;                 // How often counted answers are added to STATS_FILE
+const int STATS_COMPACT_INTERVAL_MS = 60000;             // How often STATS_FILE is checked for space to give back
+const size_t RESULT_LOG_BATCH_SIZE = 32;                 // Results per fsync of RESULT_LOG_FILE
+const int RESULT_LOG_DELAY_MS = 2;                       // Longest a result waits for others to share its fsync
+const size_t RESULT_LOG_COMPACT_EVERY = 256;             // Logged results that trigger a move into LEADERBOARD_FILE
+const string TIMINGS_FILE = "quiz_timings.json";          // Written at exit when built with -DQUIZ_TRACE
+const size_t ADAPTIVE_MAX_QUESTIONS = 20;                // Longest adaptive quiz
+const double ADAPTIVE_TARGET_ERROR = 0.3;                // Adaptive quiz ends once the ability is known this well
+
+ConsoleInput input;  // All keyboard input goes through this reader
 
 class Admin {
 protected:
@@ -16,8 +58,8 @@ public:
     Admin(string n, int i) : name(n), id(i) {}
     virtual void displayRole() = 0;
     void displayInfo() {
-        cout << "Name: " << name << endl;
-        cout << "ID: " << id << endl;
+        cout << "Name: " << name << "\n";
+        cout << "ID: " << id << "\n";
     }
     virtual ~Admin() {}
 };
@@ -28,315 +70,849 @@ private:
 public:
     Student(string n, int i, int s = 0) : Admin(n, i), score(s) {}
     void displayRole() override {
-        cout << "Role: Student" << endl;
+        cout << "Role: Student\n";
     }
     void displayScore() {
-        cout << "Score: " << score << endl;
+        cout << "Score: " << score << "\n";
     }
     void setScore(int s) {
         score = s;
     }
-    void saveToLeaderboard() {
-        ofstream file("leaderboard.txt", ios::app);
-        if (file.is_open()) {
-            file << setw(20) << name << setw(10) << id << setw(10) << score << endl;
-            file.close();
-        } else {
-            cout << "Unable to open leaderboard file for writing!" << endl;
+    // Returns once the result is safely on the disk
+    void saveToLeaderboard(ResultLog &results) {
+        if (!results.append(name, id, score)) {
+            cout << "Unable to save the result to the leaderboard!" << endl;
         }
     }
 };
 
 class Quiz {
+private:
+    BankCache questions{QUESTIONS_FILE, COMPILED_QUESTIONS_FILE};  // Reloaded when QUESTIONS_FILE changes
+    QuestionStatsStore stats;
+    unique_ptr<StatsWriter> statsWriter;  // Declared after stats so it is stopped and flushed first
+    unique_ptr<StatsCompactor> statsCompactor;
+    mutex statsOpenLock;  // Keeps flushStats() on the signal thread from seeing statsWriter half set up
+    unique_ptr<ResultLog> resultLog;
+    ResponseLog responses;
+    shared_ptr<const BankSnapshot> adaptiveBank;  // Version of the bank adaptiveItems was calibrated on
+    AdaptiveItemIndex adaptiveItems;
 public:
+    // Leave every result in LEADERBOARD_FILE for whoever reads it next
+    ~Quiz() {
+        if (resultLog) {
+            resultLog->compact();
+        }
+    }
+
+    // Each record is appended with one locked write, so other quiz processes
+    // sharing questions.txt never see half of it
     void addMultipleChoiceQuestion(string qText, string options[], int numOptions, int correctAns) {
-        ofstream file("questions.txt", ios::app);
-        if (file.is_open()) {
-            file << "MCQ\n";
-            file << qText << endl;
-            for (int i = 0; i < numOptions; ++i) {
-                file << options[i] << endl;
-            }
-            file << correctAns << endl;
-            file.close();
-            cout << "Question added successfully!\n";
+        QuestionRecord q;
+        q.type = QUESTION_MCQ;
+        q.text = qText;
+        q.numOptions = min(numOptions, MAX_OPTIONS);
+        for (int i = 0; i < q.numOptions; ++i) {
+            q.options[i] = options[i];
+        }
+        q.correctAnswer = correctAns;
+        string record;
+        formatQuestionRecord(record, q);
+        uint32_t id;
+        if (appendQuestionRecord(QUESTIONS_FILE, QUESTIONS_INDEX_FILE, record, &id)) {
+            cout << "Question added successfully! (ID " << id << ")\n";
         } else {
             cout << "Unable to open file for writing!\n";
         }
     }
 
     void addTrueFalseQuestion(string qText, int correctAns) {
-        ofstream file("questions.txt", ios::app);
-        if (file.is_open()) {
-            file << "TF\n";
-            file << qText << endl;
-            file << correctAns << endl;
-            file.close();
-            cout << "Question added successfully!\n";
+        QuestionRecord q;
+        q.type = QUESTION_TF;
+        q.text = qText;
+        q.correctAnswer = correctAns;
+        string record;
+        formatQuestionRecord(record, q);
+        uint32_t id;
+        if (appendQuestionRecord(QUESTIONS_FILE, QUESTIONS_INDEX_FILE, record, &id)) {
+            cout << "Question added successfully! (ID " << id << ")\n";
         } else {
             cout << "Unable to open file for writing!\n";
         }
     }
 
-    void updateQuestionStats(const string &qText, bool correct) {
-        // Open stats file for reading and writing stats
-        fstream file("question_stats.txt", ios::in | ios::out | ios::app);
-        string line;
-        bool found = false;
-        
-        while (getline(file, line)) {
-            if (line == qText) {  // Found the question in the stats file
-                int attempts, correctCount;
-                file >> attempts >> correctCount;
-                file.ignore();
+    // Open the statistics store, converting the old text file the first time
+    bool openStats() {
+        lock_guard<mutex> guard(statsOpenLock);
+        if (statsWriter) {
+            return true;
+        }
+        TRACE_SPAN(TRACE_OPEN);
+        if (!getFileInfo(STATS_FILE).exists && getFileInfo(OLD_STATS_FILE).exists) {
+            migrateStats();
+        }
+        if (!stats.open(STATS_FILE)) {
+            return false;
+        }
+        statsWriter.reset(new StatsWriter(stats, chrono::milliseconds(STATS_WRITE_INTERVAL_MS)));
+        statsCompactor.reset(new StatsCompactor(STATS_FILE, chrono::milliseconds(STATS_COMPACT_INTERVAL_MS)));
+        return true;
+    }
 
-                attempts++;
-                if (correct) {
-                    correctCount++;
-                }
+    // Write every answer counted so far to STATS_FILE; safe from any thread
+    void flushStats() {
+        lock_guard<mutex> guard(statsOpenLock);
+        if (statsWriter) {
+            statsWriter->flush();
+        }
+    }
 
-                long pos = file.tellg();  // Save current position
-                file.seekp(pos - (line.length() + 1), ios::beg);  // Seek back to position of the question
-                file << attempts << " " << correctCount << endl;
-                found = true;
-                break;
+    // Which question IDs the statistics are worth keeping for. IDs above the
+    // highest in the bank are kept too, as they belong to questions added
+    // since the bank was read. Empty, keeping everything, without a bank.
+    function<bool(uint32_t)> liveQuestionIds() {
+        shared_ptr<const BankSnapshot> snapshot = questions.snapshot();
+        if (!snapshot) {
+            return nullptr;
+        }
+        return [snapshot](uint32_t id) {
+            size_t ordinal;
+            return id > snapshot->bank.highestId() || snapshot->bank.ordinalOf(id, ordinal);
+        };
+    }
+
+    // Rewrite STATS_FILE without the statistics of removed questions and
+    // without slots it does not need
+    void compactStats() {
+        StatsCompaction report;
+        if (QuestionStatsStore::compact(STATS_FILE, liveQuestionIds(), &report, true)) {
+            cout << "Kept " << report.kept << " entries, dropped " << report.dropped << " of removed questions; "
+                 << STATS_FILE << " went from " << report.bytesBefore << " to " << report.bytesAfter << " bytes\n";
+        } else {
+            cout << "Unable to compact " << STATS_FILE << "!\n";
+        }
+    }
+
+    // Open the result log, recovering it if the last run crashed
+    bool openResults() {
+        if (resultLog) {
+            return true;
+        }
+        TRACE_SPAN(TRACE_OPEN);
+        unique_ptr<ResultLog> log(new ResultLog(RESULT_LOG_BATCH_SIZE, chrono::milliseconds(RESULT_LOG_DELAY_MS),
+                                                RESULT_LOG_COMPACT_EVERY));
+        uint64_t truncated;
+        if (!log->open(RESULT_LOG_FILE, LEADERBOARD_FILE, &truncated)) {
+            return false;
+        }
+        if (truncated > 0) {
+            cout << "Dropped " << truncated << " bytes of a result that was cut off by a crash\n";
+        }
+        resultLog = move(log);
+        return true;
+    }
+
+    bool openResponses() {
+        return responses.isOpen() || responses.open(RESPONSE_LOG_FILE);
+    }
+
+    // Keep the answers of one or more finished attempts for item analysis
+    void saveResponses(const vector<ResponseRecord> &attempts) {
+        if (!openResponses()) {
+            cout << "Unable to open " << RESPONSE_LOG_FILE << "!" << endl;
+            return;
+        }
+        if (!responses.append(attempts)) {
+            cout << "Unable to save the answers to " << RESPONSE_LOG_FILE << "!" << endl;
+        }
+    }
+
+    void saveResult(Student &student) {
+        TRACE_SPAN(TRACE_SAVE);
+        if (openResults()) {
+            student.saveToLeaderboard(*resultLog);
+        } else {
+            cout << "Unable to open " << RESULT_LOG_FILE << "!" << endl;
+        }
+    }
+
+    // Convert OLD_STATS_FILE into STATS_FILE, unless STATS_FILE already exists
+    void migrateStats() {
+        size_t migrated, orphaned;
+        if (getFileInfo(STATS_FILE).exists) {
+            cout << STATS_FILE << " already exists, so " << OLD_STATS_FILE << " is not migrated again\n";
+        } else if (QuestionStatsStore::migrateText(OLD_STATS_FILE, QUESTIONS_FILE, STATS_FILE, migrated, orphaned)) {
+            cout << "Migrated " << migrated << " entries from " << OLD_STATS_FILE << " (" << orphaned << " orphaned entries dropped)\n";
+            if (migrated > 0) {
+                assignIds();  // The migrated statistics now stay with their questions whatever is edited later
+            }
+        } else {
+            cout << "Unable to migrate " << OLD_STATS_FILE << "!\n";
+        }
+    }
+
+    // Write every question's ID into questions.txt, so that removing or
+    // reordering questions by hand never moves statistics to another question
+    void assignIds() {
+        size_t assigned;
+        if (assignQuestionIds(QUESTIONS_FILE, QUESTIONS_INDEX_FILE, assigned)) {
+            if (assigned > 0) {
+                cout << "Wrote the IDs of " << assigned << " questions into " << QUESTIONS_FILE << "\n";
+            }
+        } else {
+            cout << "Unable to write question IDs into " << QUESTIONS_FILE << "!\n";
+        }
+    }
+
+    // Count the answer in memory for the background writer, so the next question shows up right away
+    void updateQuestionStats(uint32_t questionId, bool correct) {
+        TRACE_SPAN(TRACE_STATS);
+        if (openStats()) {
+            statsWriter->record(questionId, correct);
+        } else {
+            cout << "Unable to update question statistics!\n";
+        }
+    }
+
+    // Ask one question and return true if it was answered correctly in time.
+    // 'choice' is set to the answer given, 0 when time ran out.
+    bool askQuestion(const QuestionRecord &q, int &choice) {
+        {
+            TRACE_SPAN(TRACE_RENDER);
+            Screen screen;
+            string shown = "\n";
+            renderQuestion(shown, q);  // The text and numbered options
+            screen << shown << "You have " << TIME_LIMIT << " seconds to answer.\nYour answer: ";
+            screen.show();
+        }
+
+        // The time limit starts when this question is shown
+        chrono::steady_clock::time_point shownAt = chrono::steady_clock::now();
+        string answer;
+        InputStatus status;
+        {
+            TRACE_SPAN(TRACE_WAIT);
+            status = input.readLine(answer, shownAt + chrono::seconds(TIME_LIMIT));
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - shownAt).count();
+        choice = 0;
+
+        if (status == INPUT_TIMEOUT) {
+            input.discardLateInput();
+            cout << "\nTime Up!\n";
+            return false;
+        }
+
+        if (status == INPUT_OK) {
+            choice = ConsoleInput::parseInt(answer);
+        }
+        bool correct = status == INPUT_OK && checkQuestionAnswer(q, choice);
+        ostringstream took;
+        took << fixed << setprecision(1) << seconds;
+        if (correct) {
+            cout << "Correct! (answered in " << took.str() << " s)\n";
+        } else {
+            cout << "Wrong! (answered in " << took.str() << " s)\n";
+        }
+        return correct;
+    }
+
+    // Run the quiz over the whole bank, or over drawCount questions picked at random
+    int startQuiz(size_t drawCount = 0) {
+        // The bank is parsed once and kept; questions added meanwhile show up
+        // in the next quiz, not in this one. Until something needs the whole
+        // bank, random questions are read through QUESTIONS_INDEX_FILE alone.
+        shared_ptr<const BankSnapshot> snapshot;
+        QuestionIndex index;
+        if (drawCount > 0 && !questions.isLoaded()) {
+            if (!index.open(QUESTIONS_FILE, QUESTIONS_INDEX_FILE)) {
+                cout << "Unable to open file for reading!\n";
+                return 0;
+            }
+        } else {
+            snapshot = questions.snapshot();
+            if (!snapshot) {
+                cout << "Unable to open file for reading!\n";
+                return 0;
+            }
+        }
+
+        size_t total = snapshot ? snapshot->bank.size() : index.size();
+        vector<size_t> picked;
+        if (drawCount > 0) {
+            mt19937_64 rng(random_device{}());
+            picked = sampleQuestionOrdinals(total, drawCount, rng);
+            total = picked.size();
+        }
+
+        int score = 0;
+        vector<ResponseRecord> attempt;
+
+        for (size_t i = 0; i < total; ++i) {
+            size_t ordinal = drawCount > 0 ? picked[i] : i;
+            QuestionRecord q;
+            if (snapshot) {
+                q = snapshot->bank.question(ordinal);
+            } else if (!index.fetch(ordinal, q)) {
+                continue;
+            }
+
+            int choice;
+            bool correct = askQuestion(q, choice);
+            if (correct) {
+                score += 10;
             }
+
+            updateQuestionStats(q.id, correct);  // Update question statistics
+            attempt.push_back(makeResponse(q.id, choice, questionChoices(q), correct));
+            cout << "\n";
+        }
+        if (!attempt.empty()) {
+            attempt[0].flags |= RESPONSE_FIRST;
+            saveResponses(attempt);
         }
 
-        if (!found) {  // If question is not found, add a new entry
-            file.clear();
-            file << qText << endl << "1 " << (correct ? 1 : 0) << endl;
+        if (statsWriter) {
+            statsWriter->flush();  // Every answer of this quiz is on disk before the result is shown
         }
+        return score;  // Return the total score after the quiz
+    }
 
-        file.close();
+    // Calibrate the items of 'snapshot' for adaptive quizzes, unless that
+    // version of the bank already is. Changes to the statistics after that
+    // are picked up with the next change to the bank.
+    const AdaptiveItemIndex &calibrateAdaptive(const shared_ptr<const BankSnapshot> &snapshot) {
+        if (adaptiveBank != snapshot) {
+            vector<QuestionStat> counts;
+            if (openStats()) {
+                counts = statsWriter->all();
+            }
+            ItemAnalysis analysis;
+            bool analysed = analyseResponses(RESPONSE_LOG_FILE, analysis);
+            adaptiveItems.build(calibrateItems(snapshot->bank, counts, analysed ? &analysis : nullptr));
+            adaptiveBank = snapshot;
+        }
+        return adaptiveItems;
     }
 
-    int startQuiz() {
-        ifstream file("questions.txt");
-        if (!file.is_open()) {
+    // Run an adaptive quiz: every question is picked to suit the ability
+    // shown so far, until it is known well enough or ADAPTIVE_MAX_QUESTIONS
+    // have been asked (see adaptive.h)
+    int startAdaptiveQuiz() {
+        shared_ptr<const BankSnapshot> snapshot = questions.snapshot();
+        if (!snapshot) {
             cout << "Unable to open file for reading!\n";
             return 0;
         }
+        AdaptiveConfig config;
+        config.maxItems = ADAPTIVE_MAX_QUESTIONS;
+        config.targetError = ADAPTIVE_TARGET_ERROR;
+        AdaptiveSession session(calibrateAdaptive(snapshot), config, random_device{}());
 
-        string line;
         int score = 0;
-        time_t startTime = time(0);  // Start time for the quiz
+        vector<ResponseRecord> attempt;
+        AdaptiveItem item;
+        while (session.next(item)) {
+            QuestionRecord q = snapshot->bank.question(item.ordinal);
+
+            int choice;
+            bool correct = askQuestion(q, choice);
+            if (correct) {
+                score += 10;
+            }
+            session.answer(correct);
 
-        while (getline(file, line)) {
-            if (line == "MCQ") {
-                string qText, options[MAX_OPTIONS];
-                int correctAns, numOptions = MAX_OPTIONS;
+            updateQuestionStats(q.id, correct);
+            attempt.push_back(makeResponse(q.id, choice, questionChoices(q), correct));
+            cout << "\n";
+        }
+        if (!attempt.empty()) {
+            attempt[0].flags |= RESPONSE_FIRST;
+            saveResponses(attempt);
+            ostringstream estimate;
+            estimate << fixed << setprecision(2) << session.theta() << " (+/- " << session.standardError() << ")";
+            cout << "Estimated ability: " << estimate.str() << " after " << session.asked() << " questions\n";
+        }
 
-                getline(file, qText);
-                for (int i = 0; i < numOptions; ++i) {
-                    getline(file, options[i]);
-                }
-                file >> correctAns;
-                file.ignore();  // Ignore newline
+        if (statsWriter) {
+            statsWriter->flush();
+        }
+        return score;
+    }
 
-                // Simulating what the user sees at runtime
-                cout << "\n" << qText << endl;
-                for (int i = 0; i < numOptions; ++i) {
-                    cout << i + 1 << ". " << options[i] << endl;  // Displaying options
-                }
+    // Add every new, valid question in a CSV or JSON Lines file (see
+    // question_import.h) to the bank in one write
+    void importQuestionFile(const string &path) {
+        shared_ptr<const BankSnapshot> snapshot = questions.snapshot();  // To leave out questions already in the bank
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        ImportReport report;
+        bool ok = importQuestions(path, QUESTIONS_FILE, QUESTIONS_INDEX_FILE, snapshot ? &snapshot->bank : nullptr, report);
+        const size_t shownErrors = 20;
+        for (size_t i = 0; i < report.errors.size() && i < shownErrors; ++i) {
+            cout << path << ":" << report.errors[i].line << ": " << report.errors[i].message << "\n";
+        }
+        if (report.errors.size() > shownErrors) {
+            cout << "... and " << report.errors.size() - shownErrors << " more invalid rows\n";
+        }
+        if (!ok) {
+            cout << "Unable to import " << path << "!\n";
+            return;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        cout << "Imported " << report.imported << " of " << report.rows << " questions in " << seconds << " s ("
+             << report.duplicates << " duplicates and " << report.errors.size() << " invalid rows skipped)" << endl;
+        if (report.imported > 0) {
+            cout << "New question IDs: " << report.firstId << " to " << report.firstId + report.imported - 1 << endl;
+        }
+    }
+
+    void compileQuestionBank() {
+        size_t count = 0;
+        vector<BankParseError> errors;
+        if (QuestionBank::compile(QUESTIONS_FILE, COMPILED_QUESTIONS_FILE, &count, &errors)) {
+            for (const BankParseError &e : errors) {
+                cout << QUESTIONS_FILE << ": skipped the record at byte " << e.offset << ": " << e.message << "\n";
+            }
+            cout << "Compiled " << count << " questions into " << COMPILED_QUESTIONS_FILE << "\n";
+            QuestionBank bank;
+            size_t duplicates = bank.load(QUESTIONS_FILE, COMPILED_QUESTIONS_FILE) ? bank.duplicateIds() : 0;
+            if (duplicates > 0) {
+                cout << duplicates << " questions have the ID of an earlier question and cannot be looked up by it;"
+                     << " give them new IDs in " << QUESTIONS_FILE << "\n";
+            }
+        } else {
+            cout << "Unable to compile the question bank!\n";
+        }
+    }
 
-                time_t currentTime = time(0);
-                int answer;
-                cout << "You have " << TIME_LIMIT << " seconds to answer.\nYour answer: ";
+    // One page of the leaderboard as text, starting at position 'start'.
+    // Equal scores share a rank, the one rankOf() reports.
+    static string leaderboardPage(Leaderboard &board, size_t start) {
+        ostringstream out;
+        out << "\n------ Leaderboard ------\n";
+        out << setw(6) << "Rank" << setw(20) << "Name" << setw(10) << "ID" << setw(10) << "Score" << "\n";
+        out << "----------------------------------------------\n";
+        vector<LeaderboardEntry> rows = board.page(start, LEADERBOARD_PAGE_SIZE);
+        size_t rank = 0;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (i == 0) {
+                rank = board.rankOfScore(rows[i].score);  // The same score may start on an earlier page
+            } else if (rows[i].score != rows[i - 1].score) {
+                rank = start + i + 1;
+            }
+            out << setw(6) << rank << setw(20) << rows[i].name << setw(10) << rows[i].id
+                << setw(10) << rows[i].score << "\n";
+        }
+        if (!rows.empty()) {
+            out << "Showing " << start + 1 << "-" << start + rows.size() << " of " << board.size() << "\n";
+        }
+        return out.str();
+    }
 
-                while (difftime(currentTime, startTime) <= TIME_LIMIT) {
-                    if (cin >> answer) {
-                        break;
-                    }
-                    currentTime = time(0);
-                }
+    // Show the leaderboard best score first, one page at a time
+    void displayLeaderboard() {
+        if (openResults()) {
+            resultLog->compact();  // Show the latest results too
+        }
+        Leaderboard board;
+        if (!board.open(LEADERBOARD_FILE, LEADERBOARD_INDEX_FILE)) {
+            cout << "Unable to open leaderboard file!\n";
+            return;
+        }
 
-                bool correct = (answer == correctAns);
-                if (correct) {
-                    cout << "Correct!\n";
-                    score += 10;
+        size_t start = 0;
+        while (true) {
+            Screen screen;
+            screen << leaderboardPage(board, start);
+            screen << "n = next page, p = previous page, r = find a student's rank, anything else = back: ";
+            screen.show();
+            string command;
+            if (input.readLine(command) != INPUT_OK) {
+                break;
+            }
+            if (command == "n") {
+                if (start + LEADERBOARD_PAGE_SIZE < board.size()) {
+                    start += LEADERBOARD_PAGE_SIZE;
+                }
+            } else if (command == "p") {
+                start = start >= LEADERBOARD_PAGE_SIZE ? start - LEADERBOARD_PAGE_SIZE : 0;
+            } else if (command == "r") {
+                int id;
+                cout << "Enter the student ID: ";
+                input.readInt(id);
+
+                size_t rank;
+                int bestScore;
+                if (board.rankOf(id, rank, bestScore)) {
+                    cout << "Student " << id << "'s best result is ranked " << rank << " of " << board.size()
+                         << " results, with a score of " << bestScore << "\n";
                 } else {
-                    cout << "Wrong or Time Up!\n";
+                    cout << "No results for student " << id << "\n";
                 }
+            } else {
+                break;
+            }
+        }
+    }
 
-                updateQuestionStats(qText, correct);  // Update question statistics
-                cout << endl;
-            } else if (line == "TF") {
-                string qText;
-                int correctAns;
-
-                getline(file, qText);
-                file >> correctAns;
-                file.ignore();  // Ignore newline
-
-                // Simulating what the user sees for True/False question
-                cout << "\n" << qText << endl;
-                cout << "1. True\n2. False" << endl;
-
-                time_t currentTime = time(0);
-                int answer;
-                cout << "You have " << TIME_LIMIT << " seconds to answer.\nYour answer: ";
-
-                while (difftime(currentTime, startTime) <= TIME_LIMIT) {
-                    if (cin >> answer) {
-                        break;
-                    }
-                    currentTime = time(0);
-                }
+    // Grade a file of offline answer sheets (see grader.h) and record the
+    // results and question statistics as if each student had taken the quiz
+    void gradeAnswerSheets(const string &sheetsPath) {
+        shared_ptr<const BankSnapshot> snapshot = questions.snapshot();
+        if (!snapshot) {
+            cout << "Unable to open file for reading!\n";
+            return;
+        }
+        const QuestionBank &bank = snapshot->bank;
+        if (!openStats()) {
+            cout << "Unable to open question stats file!\n";
+            return;
+        }
 
-                bool correct = (answer == correctAns);
-                if (correct) {
-                    cout << "Correct!\n";
-                    score += 10;
-                } else {
-                    cout << "Wrong or Time Up!\n";
-                }
+        if (!openResults()) {
+            cout << "Unable to open " << RESULT_LOG_FILE << "!" << endl;
+            return;
+        }
 
-                updateQuestionStats(qText, correct);  // Update question statistics
-                cout << endl;
+        // Each stretch of sheets is saved like quiz results before the next is graded
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        GradingResult result;
+        bool saved = true;
+        bool graded = gradeSheets(bank, sheetsPath, result, 0, true, [&](const GradingResult &batch) {
+            if (batch.sheets == 0) {
+                return true;
+            }
+            if (!resultLog->append(batch.results)) {
+                saved = false;
+                return false;
             }
+            for (size_t i = 0; i < bank.size(); ++i) {
+                statsWriter->add(bank.question(i).id, (uint32_t)batch.sheets, batch.correctCounts[i]);
+            }
+            saveResponses(batch.responses);
+            return true;
+        });
+        statsWriter->flush();
+        if (!saved) {
+            cout << "Unable to save the results to the leaderboard! Stopped after " << result.sheets << " sheets\n";
+            return;
+        }
+        if (!graded) {
+            cout << "Unable to open answer sheets file!\n";
+            return;
         }
 
-        file.close();
-        return score;  // Return the total score after the quiz
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        cout << "Graded " << result.sheets << " answer sheets in " << seconds << " s";
+        if (result.malformed > 0) {
+            cout << " (" << result.malformed << " malformed lines skipped)";
+        }
+        cout << endl;
     }
 
-    void displayLeaderboard() {
-        ifstream file("leaderboard.txt");
-        if (file.is_open()) {
-            cout << "\n------ Leaderboard ------\n";
-            cout << setw(20) << "Name" << setw(10) << "ID" << setw(10) << "Score" << endl;
-            cout << "----------------------------\n";
-            string name;
-            int id, score;
-
-            while (file >> name >> id >> score) {
-                cout << setw(20) << name << setw(10) << id << setw(10) << score << endl;
-            }
+    // Serve quizzes to many students at once over a local socket (see server.h).
+    // target is a loopback TCP port number or a Unix socket path.
+    bool runServer(const string &target) {
+        shared_ptr<const BankSnapshot> snapshot = questions.snapshot();
+        if (!snapshot) {
+            cout << "Unable to open file for reading!\n";
+            return false;
+        }
+        if (!openStats()) {
+            cout << "Unable to open question stats file!\n";
+            return false;
+        }
 
-            file.close();
-        } else {
-            cout << "Unable to open leaderboard file!\n";
+        QuizServerConfig config;
+        config.timeLimitSeconds = TIME_LIMIT;
+        if (!target.empty() && target.find_first_not_of("0123456789") == string::npos) {
+            config.tcpPort = stoi(target);
+        } else if (!target.empty()) {
+            config.unixPath = target;
+        }
+
+        QuizServerHooks hooks;
+        hooks.recordAnswer = [this](uint32_t questionId, bool correct) {
+            TRACE_SPAN(TRACE_STATS);
+            statsWriter->record(questionId, correct);
+        };
+        if (!openResults()) {
+            cout << "Unable to open " << RESULT_LOG_FILE << "!\n";
+            return false;
+        }
+        hooks.saveResult = [this](const string &name, int id, int score) {
+            Student student(name, id, score);
+            saveResult(student);  // Students finishing together share one fsync
+        };
+        if (!openResponses()) {
+            cout << "Unable to open " << RESPONSE_LOG_FILE << "!\n";
+            return false;
+        }
+        hooks.saveResponses = [this](const vector<ResponseRecord> &attempt) { saveResponses(attempt); };
+        hooks.leaderboardText = [this]() {
+            resultLog->compact();
+            Leaderboard board;
+            if (!board.open(LEADERBOARD_FILE, LEADERBOARD_INDEX_FILE)) {
+                return string("Unable to open leaderboard file!\n");
+            }
+            return leaderboardPage(board, 0);
+        };
+
+        cout << "Serving " << snapshot->bank.size() << " questions on "
+             << (config.tcpPort ? "127.0.0.1:" + to_string(config.tcpPort) : config.unixPath)
+             << " (Ctrl+C to stop)" << endl;
+        snapshot.reset();  // Sessions take the newest version as they start
+        if (!runQuizServer(questions, config, hooks)) {
+            cout << "Unable to start the quiz server!\n";
+            return false;
         }
+        cout << "Server stopped.\n";
+        return true;
     }
 
     void displayQuestionStats() {
-        ifstream file("question_stats.txt");
-        if (file.is_open()) {
-            cout << "\n------ Question Statistics ------\n";
-            cout << setw(30) << "Question" << setw(15) << "Attempts" << setw(15) << "Correct" << endl;
-            cout << "-----------------------------------------------------------\n";
-            string qText;
-            int attempts, correctCount;
-
-            while (getline(file, qText)) {
-                file >> attempts >> correctCount;
-                file.ignore();
-                cout << setw(30) << qText << setw(15) << attempts << setw(15) << correctCount << endl;
+        if (openStats()) {
+            shared_ptr<const BankSnapshot> snapshot = questions.snapshot();  // Only needed for the question texts
+
+            Screen screen;
+            screen << "\n------ Question Statistics ------\n";
+            screen << setw(30) << "Question" << setw(15) << "Attempts" << setw(15) << "Correct" << "\n";
+            screen << "-----------------------------------------------------------\n";
+
+            for (const QuestionStat &s : statsWriter->all()) {
+                QuestionRecord q;
+                string qText = snapshot && snapshot->bank.find(s.id, q) ? string(q.text) : "#" + to_string(s.id);
+                screen << setw(30) << qText << setw(15) << s.attempts << setw(15) << s.correct << "\n";
             }
-
-            file.close();
+            screen << itemAnalysisText(snapshot ? &snapshot->bank : nullptr);
+            screen.show();
         } else {
             cout << "Unable to open question stats file!\n";
         }
     }
+
+    // Difficulty, discrimination and option choices of every question from
+    // RESPONSE_LOG_FILE, also written to ITEM_ANALYSIS_FILE
+    static string itemAnalysisText(const QuestionBank *bank) {
+        ostringstream out;
+        ItemAnalysis analysis;
+        if (!analyseResponses(RESPONSE_LOG_FILE, analysis)) {
+            out << "Unable to read " << RESPONSE_LOG_FILE << "!\n";
+            return out.str();
+        }
+        if (analysis.attempts == 0) {
+            return out.str();  // Nothing answered since answers were first logged
+        }
+
+        out << "\n------ Item Analysis ------\n";
+        out << setw(30) << "Question" << setw(10) << "Answers" << setw(8) << "p" << setw(8) << "r_pb";
+        for (int c = 1; c <= MAX_OPTIONS; ++c) {
+            out << setw(6) << "%" + to_string(c);
+        }
+        out << setw(8) << "%none" << "\n";
+        out << "-------------------------------------------------------------------------------------\n";
+        out << fixed;
+        for (const ItemStats &s : analysis.items) {
+            QuestionRecord q;
+            string qText = bank && bank->find(s.id, q) ? string(q.text) : "#" + to_string(s.id);
+            out << setw(30) << qText << setw(10) << s.answers << setprecision(2) << setw(8) << s.difficulty
+                << setw(8) << s.discrimination << setprecision(0);
+            for (int c = 1; c <= MAX_OPTIONS; ++c) {
+                out << setw(6) << s.choiceRates[c] * 100;
+            }
+            out << setw(8) << s.choiceRates[0] * 100 << "\n";
+        }
+        out << setprecision(3) << "Attempts: " << analysis.attempts << ", mean score " << analysis.meanScore
+            << " right answers, Cronbach's alpha " << analysis.alpha << "\n";
+        if (writeItemAnalysisCsv(ITEM_ANALYSIS_FILE, analysis, bank)) {
+            out << "Written to " << ITEM_ANALYSIS_FILE << "\n";
+        } else {
+            out << "Unable to write " << ITEM_ANALYSIS_FILE << "!\n";
+        }
+        return out.str();
+    }
+
+    // Export the item analysis without opening the menu
+    void exportItemAnalysis() {
+        shared_ptr<const BankSnapshot> snapshot = questions.snapshot();
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+        ItemAnalysis analysis;
+        if (!analyseResponses(RESPONSE_LOG_FILE, analysis)) {
+            cout << "Unable to read " << RESPONSE_LOG_FILE << "!\n";
+            return;
+        }
+        if (!writeItemAnalysisCsv(ITEM_ANALYSIS_FILE, analysis, snapshot ? &snapshot->bank : nullptr)) {
+            cout << "Unable to write " << ITEM_ANALYSIS_FILE << "!\n";
+            return;
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+        cout << "Analysed " << analysis.answers << " answers from " << analysis.attempts << " attempts in " << seconds
+             << " s (Cronbach's alpha " << analysis.alpha << "); written to " << ITEM_ANALYSIS_FILE << endl;
+    }
 };
 
-void printBoxedText(string text) {
-    int len = text.length() + 4;
-    cout << "\n";
-    for (int i = 0; i < len; i++) cout << "-";  // Top border
-    cout << "\n| " << text << " |\n";  // Centered text
-    for (int i = 0; i < len; i++) cout << "-";  // Bottom border
-    cout << "\n";
-}
+// Log a student in, run the quiz (the whole bank, drawCount random questions
+// or an adaptive quiz) and record the result
+void takeQuiz(Quiz &quiz, size_t drawCount, bool adaptive = false) {
+    string studentName;
+    int studentID;
 
-void printBigQuizText() {
-    // Printing large "QUIZ" title in ASCII art using boxes
-    cout << "\n";
-    cout << "  QQQQQ   U   U   III   ZZZZZ\n";
-    cout << " Q     Q  U   U    I       Z\n";
-    cout << " Q     Q  U   U    I      Z\n";
-    cout << " Q   Q Q  U   U    I     Z\n";
-    cout << "  QQQQQ   UUUUU   III   ZZZZZ\n";
-    cout << "\n";
-}
+    cout << "Enter your name: ";
+    input.readLine(studentName);
+    cout << "Enter your student ID: ";
+    input.readInt(studentID);
+
+    Student student(studentName, studentID);
 
+    student.displayInfo();
+    student.displayRole();
 
-int main() {
+    int score = adaptive ? quiz.startAdaptiveQuiz() : quiz.startQuiz(drawCount);
+    student.setScore(score);
+
+    cout << "Quiz completed! Your score: " << score << "\n";
+
+    quiz.saveResult(student);
+}
+
+int main(int argc, char *argv[]) {
     Quiz quiz;
     int choice;
 
+    // "final --plain ..." leaves out boxes and the title, for piping the output
+    if (argc > 1 && string(argv[1]) == "--plain") {
+        Screen::setPlain(true);
+        --argc;
+        ++argv;
+    }
+
+    // Ctrl-C or a kill writes the answers counted so far before the process
+    // ends. The server stops on those signals by itself and flushes on the way out.
+    // Declared after quiz, so a signal once quiz is being destroyed no longer touches it.
+    TerminationHook flushOnSignal;
+    if (!(argc > 1 && string(argv[1]) == "--server")) {
+        flushOnSignal = onTerminationSignal([&quiz] { quiz.flushStats(); });
+    }
+    // With -DQUIZ_TRACE: SIGUSR1 prints the session timings, and they are saved at exit
+    installTraceSignal();
+    atexit([] { writeTraceJson(TIMINGS_FILE); });
+    // "final --compile" rebuilds the compiled bank without opening the menu
+    if (argc > 1 && string(argv[1]) == "--compile") {
+        quiz.compileQuestionBank();
+        return 0;
+    }
+    // "final --import <CSV or JSON Lines file>" adds the questions in it to the bank
+    if (argc > 2 && string(argv[1]) == "--import") {
+        quiz.importQuestionFile(argv[2]);
+        return 0;
+    }
+    // "final --grade <answer sheets file>" grades offline answer sheets
+    if (argc > 2 && string(argv[1]) == "--grade") {
+        quiz.gradeAnswerSheets(argv[2]);
+        return 0;
+    }
+    // "final --server [port | socket path]" serves many students at once
+    if (argc > 1 && string(argv[1]) == "--server") {
+        return quiz.runServer(argc > 2 ? argv[2] : "") ? 0 : 1;
+    }
+    // "final --item-analysis" analyses the logged answers into item_analysis.csv
+    if (argc > 1 && string(argv[1]) == "--item-analysis") {
+        quiz.exportItemAnalysis();
+        return 0;
+    }
+    // "final --assign-ids" writes every question's ID into questions.txt
+    if (argc > 1 && string(argv[1]) == "--assign-ids") {
+        quiz.assignIds();
+        return 0;
+    }
+    // "final --compact-stats" drops the statistics of removed questions from question_stats.dat
+    if (argc > 1 && string(argv[1]) == "--compact-stats") {
+        quiz.compactStats();
+        return 0;
+    }
+    // "final --migrate-stats" converts question_stats.txt into the binary store
+    if (argc > 1 && string(argv[1]) == "--migrate-stats") {
+        quiz.migrateStats();
+        return 0;
+    }
+
+    // cout is only flushed before waiting for input, not on every line
+    ios::sync_with_stdio(false);
+
     // Displaying the initial menu with a boxed title
-    printBigQuizText();
-    printBoxedText("Welcome to the Quiz Management System!");
+    Screen screen;
+    screen.title();
+    screen.boxed("Welcome to the Quiz Management System!");
 
     while (true) {
-        // Main menu
-        cout << "\n";
-        printBoxedText("1. Add a Question");
-        printBoxedText("2. Start the Quiz");
-        printBoxedText("3. View Leaderboard");
-        printBoxedText("4. View Question Statistics");
-        printBoxedText("5. Exit");
-
-        cout << "\nEnter your choice: ";
-        cin >> choice;
-
-        if (choice == 1) {
+        // Main menu, shown together with the welcome the first time
+        screen << "\n";
+        for (const MenuItem &item : MAIN_MENU) {
+            screen.boxed(menuEntry(item));
+        }
+        screen << "\nEnter your choice: ";
+        screen.show();
+        if (input.readInt(choice) == INPUT_EOF) {
+            cout << "\nExiting the system...\n";  // Input closed, nobody left to ask
+            break;
+        }
+
+        if (choice == MENU_ADD_QUESTION) {
             string qText, options[MAX_OPTIONS];
             int type, correctAns;
 
-            cout << "Enter 1 for MCQ, 2 for True/False: ";
-            cin >> type;
-            cin.ignore();  // Ignore newline
+            cout << "Enter 1 for MCQ, 2 for True/False, 3 to import a CSV or JSON Lines file: ";
+            input.readInt(type);
 
             if (type == 1) {
                 cout << "Enter the question: ";
-                getline(cin, qText);
+                input.readLine(qText);
                 cout << "Enter the options:\n";
                 for (int i = 0; i < MAX_OPTIONS; ++i) {
                     cout << "Option " << i + 1 << ": ";
-                    getline(cin, options[i]);
+                    input.readLine(options[i]);
                 }
                 cout << "Enter the number of the correct option (1-" << MAX_OPTIONS << "): ";
-                cin >> correctAns;
+                input.readInt(correctAns);
 
                 quiz.addMultipleChoiceQuestion(qText, options, MAX_OPTIONS, correctAns);
             } else if (type == 2) {
                 cout << "Enter the True/False question: ";
-                getline(cin, qText);
+                input.readLine(qText);
                 cout << "Enter 1 for True, 2 for False: ";
-                cin >> correctAns;
+                input.readInt(correctAns);
 
                 quiz.addTrueFalseQuestion(qText, correctAns);
+            } else if (type == 3) {
+                string path;
+                cout << "Enter the path of the file: ";
+                input.readLine(path);
+                quiz.importQuestionFile(path);
             }
-        } else if (choice == 2) {
-            string studentName;
-            int studentID;
-
-            cout << "Enter your name: ";
-            cin.ignore();
-            getline(cin, studentName);
-            cout << "Enter your student ID: ";
-            cin >> studentID;
-
-            Student student(studentName, studentID);
-
-            student.displayInfo();
-            student.displayRole();
-
-            int score = quiz.startQuiz();
-            student.setScore(score);
-
-            cout << "Quiz completed! Your score: " << score << endl;
-
-            student.saveToLeaderboard();
-        } else if (choice == 3) {
+        } else if (choice == MENU_START_QUIZ) {
+            takeQuiz(quiz, 0);
+        } else if (choice == MENU_LEADERBOARD) {
             quiz.displayLeaderboard();
-        } else if (choice == 4) {
+        } else if (choice == MENU_QUESTION_STATS) {
             quiz.displayQuestionStats();
-        } else if (choice == 5) {
+        } else if (choice == MENU_COMPILE_BANK) {
+            quiz.compileQuestionBank();
+        } else if (choice == MENU_RANDOM_QUIZ) {
+            int drawCount;
+            cout << "How many questions should be drawn? ";
+            input.readInt(drawCount);
+            if (drawCount > 0) {
+                takeQuiz(quiz, (size_t)drawCount);
+            } else {
+                cout << "Invalid number of questions!\n";
+            }
+        } else if (choice == MENU_ADAPTIVE_QUIZ) {
+            takeQuiz(quiz, 0, true);
+        } else if (choice == MENU_TIMINGS) {
+            Screen screen;
+            screen << "\n" << traceReport();
+            screen.show();
+        } else if (choice == MENU_EXIT) {
             cout << "Exiting the system...\n";
             break;
         } else {
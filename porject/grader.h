@@ -0,0 +1,222 @@
+#ifndef GRADER_H
+#define GRADER_H
+
+// Headless grading of answer sheets collected offline.
+//
+// An answer sheet file has one student per line:
+//
+//     studentID,name,answer1,answer2,...
+//
+// with answers in bank order (1-based option numbers, empty for unanswered).
+// The file is mapped and split into chunks at line boundaries, every core
+// grades one chunk, and the per-chunk results are combined in file order.
+// Scoring is the same as startQuiz: 10 points per correct answer, and every
+// question in the bank counts as attempted. When asked for, every sheet is
+// also turned into one attempt's records for the response log.
+//
+// A caller that saves the results as it goes grades the file one stretch of
+// SHEET_BATCH_BYTES at a time, so memory does not grow with the number of
+// sheets.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "leaderboard.h"
+#include "platform.h"
+#include "question_bank.h"
+#include "question_kinds.h"
+#include "response_log.h"
+
+const size_t SHEET_BATCH_BYTES = 8 << 20;
+
+struct GradingResult {
+    std::vector<LeaderboardEntry> results;  // One per sheet, in file order
+    std::vector<uint32_t> correctCounts; // Per question, in bank order
+    std::vector<ResponseRecord> responses;  // One attempt per sheet, if collected
+    size_t sheets = 0;
+    size_t malformed = 0;                // Lines that were not a valid sheet
+};
+
+// Parse an optionally signed integer at p, stopping at ',' or end
+inline bool parseSheetInt(const char *&p, const char *end, int &value) {
+    bool negative = false;
+    while (p < end && *p == ' ') ++p;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    const char *digits = p;
+    long v = 0;
+    while (p < end && *p >= '0' && *p <= '9' && v < 1000000000L) v = v * 10 + (*p++ - '0');
+    while (p < end && *p == ' ') ++p;
+    if (p == digits || (p < end && *p != ',')) return false;
+    value = (int)(negative ? -v : v);
+    return true;
+}
+
+// Grade the sheets in [p, end). 'ids' and 'choices' hold the question IDs
+// and numbers of choices in bank order when responses are collected, and
+// are null otherwise.
+inline void gradeSheetChunk(const char *p, const char *end, const std::vector<int32_t> &key,
+                            const std::vector<uint32_t> *ids, const std::vector<int32_t> *choices, GradingResult &r) {
+    r.correctCounts.assign(key.size(), 0);
+    std::string name;
+    std::vector<int> answers;
+    while (p < end) {
+        const char *lineEnd = (const char *)memchr(p, '\n', (size_t)(end - p));
+        if (!lineEnd) lineEnd = end;
+        const char *next = lineEnd + 1;
+        if (lineEnd > p && lineEnd[-1] == '\r') --lineEnd;
+
+        const char *q = p;
+        p = next;
+        if (q == lineEnd) continue;  // Blank line
+
+        int id;
+        if (!parseSheetInt(q, lineEnd, id) || q == lineEnd) {
+            r.malformed++;
+            continue;
+        }
+        const char *nameStart = ++q;
+        while (q < lineEnd && *q != ',') ++q;
+        const char *nameEnd = q;
+        while (nameStart < nameEnd && *nameStart == ' ') ++nameStart;
+        while (nameEnd > nameStart && nameEnd[-1] == ' ') --nameEnd;
+        name.assign(nameStart, nameEnd);
+
+        bool valid = true;
+        answers.assign(key.size(), 0);
+        for (size_t i = 0; q < lineEnd; ++i) {
+            ++q;  // Skip the ','
+            int answer = 0;
+            while (q < lineEnd && *q == ' ') ++q;
+            if (q < lineEnd && *q != ',' && !parseSheetInt(q, lineEnd, answer)) {
+                valid = false;
+                break;
+            }
+            if (i < key.size()) answers[i] = answer;
+        }
+        if (!valid) {
+            r.malformed++;
+            continue;
+        }
+
+        int score = 0;
+        for (size_t i = 0; i < key.size(); ++i) {
+            bool correct = answers[i] == key[i];
+            if (correct) {
+                r.correctCounts[i]++;
+                score += 10;
+            }
+            if (ids) {
+                r.responses.push_back(makeResponse((*ids)[i], answers[i], (*choices)[i], correct));
+                if (i == 0) r.responses.back().flags |= RESPONSE_FIRST;
+            }
+        }
+
+        r.results.push_back(LeaderboardEntry{name, id, score, 0});
+        r.sheets++;
+    }
+}
+
+// Grade the sheets in [begin, end) on up to 'threads' cores into r. The
+// range is split at line boundaries, at least 1 MB per chunk.
+inline void gradeSheetRange(const char *begin, const char *end, const std::vector<int32_t> &key,
+                            const std::vector<uint32_t> *ids, const std::vector<int32_t> *choices, size_t threads,
+                            GradingResult &r) {
+    size_t size = (size_t)(end - begin);
+    threads = std::max<size_t>(1, std::min(threads, size / (1 << 20) + 1));
+    std::vector<const char *> bounds(1, begin);
+    for (size_t t = 1; t < threads; ++t) {
+        const char *cut = std::max(bounds.back(), begin + size * t / threads);
+        const char *nl = (const char *)memchr(cut, '\n', (size_t)(end - cut));
+        bounds.push_back(nl ? nl + 1 : end);
+    }
+    bounds.push_back(end);
+
+    std::vector<GradingResult> parts(threads);
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(gradeSheetChunk, bounds[t], bounds[t + 1], std::cref(key), ids, choices, std::ref(parts[t]));
+    }
+    gradeSheetChunk(bounds[0], bounds[1], key, ids, choices, parts[0]);
+    for (std::thread &t : pool) t.join();
+
+    // Combine in file order so the leaderboard rows keep the sheet order
+    r = GradingResult();
+    r.correctCounts.assign(key.size(), 0);
+    size_t resultCount = 0, responseCount = 0;
+    for (const GradingResult &part : parts) {
+        resultCount += part.results.size();
+        responseCount += part.responses.size();
+    }
+    r.results.reserve(resultCount);
+    r.responses.reserve(responseCount);
+    for (GradingResult &part : parts) {
+        std::move(part.results.begin(), part.results.end(), std::back_inserter(r.results));
+        r.responses.insert(r.responses.end(), part.responses.begin(), part.responses.end());
+        std::vector<ResponseRecord>().swap(part.responses);
+        for (size_t i = 0; i < key.size(); ++i) r.correctCounts[i] += part.correctCounts[i];
+        r.sheets += part.sheets;
+        r.malformed += part.malformed;
+    }
+}
+
+// Grade every sheet in sheetsPath against the bank on 'threads' cores (0 =
+// all). With 'onBatch', the file is graded SHEET_BATCH_BYTES at a time and
+// each stretch's sheets are handed to it in file order; 'result' then keeps
+// only the totals. Grading stops, returning false, when onBatch does.
+inline bool gradeSheets(const QuestionBank &bank, const std::string &sheetsPath, GradingResult &result,
+                        size_t threads = 0, bool collectResponses = false,
+                        const std::function<bool(const GradingResult &batch)> &onBatch = nullptr) {
+    result = GradingResult();
+    result.correctCounts.assign(bank.size(), 0);
+
+    MappedFile sheets;
+    if (!sheets.open(sheetsPath)) {
+        return getFileInfo(sheetsPath).exists;  // An empty file has nothing to grade
+    }
+
+    std::vector<int32_t> key(bank.size()), choices(bank.size());
+    std::vector<uint32_t> ids(bank.size());
+    for (size_t i = 0; i < bank.size(); ++i) {
+        QuestionRecord q = bank.question(i);
+        // An answer the question cannot take is never right, as in the quiz
+        key[i] = validQuestionAnswer(q, q.correctAnswer) ? q.correctAnswer : INT32_MIN;
+        ids[i] = q.id;
+        choices[i] = questionChoices(q);
+    }
+    const std::vector<uint32_t> *wantIds = collectResponses ? &ids : nullptr;
+    const std::vector<int32_t> *wantChoices = collectResponses ? &choices : nullptr;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const char *end = sheets.data() + sheets.size();
+    GradingResult batch;
+    for (const char *from = sheets.data(); from < end;) {
+        const char *to = end;
+        if (onBatch && (size_t)(end - from) > SHEET_BATCH_BYTES) {
+            const char *nl = (const char *)memchr(from + SHEET_BATCH_BYTES, '\n', (size_t)(end - from) - SHEET_BATCH_BYTES);
+            to = nl ? nl + 1 : end;
+        }
+        gradeSheetRange(from, to, key, wantIds, wantChoices, threads, batch);
+        from = to;
+
+        if (onBatch && !onBatch(batch)) return false;  // The totals cover the batches taken
+        for (size_t i = 0; i < key.size(); ++i) result.correctCounts[i] += batch.correctCounts[i];
+        result.sheets += batch.sheets;
+        result.malformed += batch.malformed;
+        if (!onBatch) {
+            result.results.swap(batch.results);
+            result.responses.swap(batch.responses);
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,289 @@
+#ifndef ITEM_ANALYSIS_H
+#define ITEM_ANALYSIS_H
+
+// Classical item analysis over the response log (see response_log.h).
+//
+// For every question: its difficulty (the p-value, the share of answers that
+// were right), its discrimination (the point-biserial correlation between
+// getting it right and the score on the rest of the attempt) and how often
+// each option was picked. For the test as a whole: Cronbach's alpha.
+//
+// The log is mapped and split between threads at attempt boundaries. A
+// first pass finds the questions that were answered and gives each one a
+// row, in ID order, so a question added by hand with a huge ID costs one
+// row like any other. Every thread then adds its answers into its own table
+// of 64-bit integer sums, one row per answered question, so the threads
+// share nothing. The tables are then added together by all threads at once,
+// each taking a slice of the rows, and the statistics are worked out from
+// the sums. Both of those passes are plain loops over flat arrays that the
+// compiler vectorizes. The per-answer pass is a scatter into the table and
+// does not vectorize, which is why the rows are kept narrow: one answer
+// touches one or two cache lines. Integer sums also make the result the
+// same for any number of threads.
+//
+// The attempts of random quizzes answer different subsets of the bank, so
+// alpha is worked out for an attempt of the average length k:
+//
+//     alpha = k / (k - 1) * (1 - k * mean item variance / score variance)
+//
+// When every attempt answers every question this is the usual alpha (KR-20).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "question_bank.h"
+#include "response_log.h"
+
+// Columns of the per-question sums
+enum ItemSum {
+    SUM_ANSWERS,
+    SUM_CORRECT,
+    SUM_REST,          // Rest score: right answers in the attempt apart from this one
+    SUM_REST_SQUARES,
+    SUM_REST_CORRECT,  // Rest score summed over the right answers only
+    SUM_CHOICES,       // MAX_OPTIONS + 1 counts, from "no valid option" up
+    SUM_COLUMNS = SUM_CHOICES + MAX_OPTIONS + 1
+};
+
+struct ItemStats {
+    uint32_t id;
+    uint64_t answers;
+    uint64_t correct;
+    double difficulty;      // Share answered right (p-value)
+    double discrimination;  // Point-biserial with the rest score; 0 when every answer was alike
+    double choiceRates[MAX_OPTIONS + 1];  // Share picking each option; [0] is time up or no valid option
+};
+
+struct ItemAnalysis {
+    std::vector<ItemStats> items;  // Questions with answers, by ID
+    uint64_t attempts = 0;
+    uint64_t answers = 0;
+    double meanScore = 0;          // Right answers per attempt
+    double scoreVariance = 0;
+    double alpha = 0;              // Cronbach's alpha; 0 when it is undefined
+};
+
+// Row of every answered question in the sums: a table indexed by ID when the
+// IDs are dense, as they are unless questions were added by hand, and a hash
+// map otherwise, as in QuestionBank
+struct ItemRows {
+    std::vector<uint32_t> ids;  // Question ID of each row, ascending
+    std::vector<uint32_t> byId;
+    std::unordered_map<uint32_t, uint32_t> bySparseId;
+
+    void build(std::vector<uint32_t> answered) {
+        std::sort(answered.begin(), answered.end());
+        answered.erase(std::unique(answered.begin(), answered.end()), answered.end());
+        ids = std::move(answered);
+        byId.clear();
+        bySparseId.clear();
+        size_t n = ids.size();
+        uint32_t highest = n ? ids.back() : 0;
+        if (highest <= 2 * n + 1024) {
+            byId.assign((size_t)highest + 1, 0);
+            for (size_t i = 0; i < n; ++i) byId[ids[i]] = (uint32_t)i;
+        } else {
+            bySparseId.reserve(n);
+            for (size_t i = 0; i < n; ++i) bySparseId.emplace(ids[i], (uint32_t)i);
+        }
+    }
+
+    // Only for IDs that were passed to build()
+    size_t row(uint32_t id) const { return byId.empty() ? bySparseId.find(id)->second : byId[id]; }
+    size_t size() const { return ids.size(); }
+};
+
+// Distinct question IDs in [begin, end)
+inline void collectQuestionIds(const ResponseRecord *begin, const ResponseRecord *end, std::vector<uint32_t> &ids) {
+    std::unordered_set<uint32_t> seen;
+    uint32_t last = 0;
+    for (const ResponseRecord *r = begin; r < end; ++r) {
+        if (r->question == last && r != begin) continue;
+        last = r->question;
+        seen.insert(last);
+    }
+    ids.assign(seen.begin(), seen.end());
+}
+
+// Sums over one thread's share of the log
+struct ItemAnalysisPart {
+    std::vector<uint64_t> sums;  // SUM_COLUMNS per row of ItemRows
+    uint64_t attempts = 0;
+    uint64_t answers = 0;
+    uint64_t scoreSum = 0;
+    uint64_t scoreSquares = 0;
+
+    size_t rows() const { return sums.size() / SUM_COLUMNS; }
+};
+
+inline void analyseResponseChunk(const ResponseRecord *begin, const ResponseRecord *end, const ItemRows &rows,
+                                 ItemAnalysisPart &part) {
+    part.sums.assign(rows.size() * SUM_COLUMNS, 0);
+    const ResponseRecord *p = begin;
+    while (p < end) {
+        // One attempt: find where it ends and its score, then add each answer
+        uint64_t score = p->flags & RESPONSE_CORRECT;
+        const ResponseRecord *stop = p + 1;
+        for (; stop < end && !(stop->flags & RESPONSE_FIRST); ++stop) score += stop->flags & RESPONSE_CORRECT;
+
+        for (const ResponseRecord *r = p; r < stop; ++r) {
+            uint64_t *row = &part.sums[rows.row(r->question) * SUM_COLUMNS];
+            uint64_t x = r->flags & RESPONSE_CORRECT;
+            uint64_t rest = score - x;
+            row[SUM_ANSWERS]++;
+            row[SUM_CORRECT] += x;
+            row[SUM_REST] += rest;
+            row[SUM_REST_SQUARES] += rest * rest;
+            row[SUM_REST_CORRECT] += x * rest;
+            row[SUM_CHOICES + (r->choice <= MAX_OPTIONS ? r->choice : 0)]++;
+        }
+        part.attempts++;
+        part.answers += (uint64_t)(stop - p);
+        part.scoreSum += score;
+        part.scoreSquares += score * score;
+        p = stop;
+    }
+}
+
+// Add rows [from, to) of every part into 'total'
+inline void reduceItemSums(const std::vector<ItemAnalysisPart> &parts, size_t from, size_t to,
+                           std::vector<uint64_t> &total) {
+    for (const ItemAnalysisPart &part : parts) {
+        size_t stop = std::min(to, part.rows()) * SUM_COLUMNS;
+        const uint64_t *src = part.sums.data();
+        uint64_t *dst = total.data();
+        for (size_t i = from * SUM_COLUMNS; i < stop; ++i) dst[i] += src[i];
+    }
+}
+
+// Analyse the response log at 'path' on 'threads' cores (0 = all). A missing
+// log gives an empty analysis.
+inline bool analyseResponses(const std::string &path, ItemAnalysis &out, size_t threads = 0) {
+    out = ItemAnalysis();
+    ResponseLogReader log;
+    if (!log.open(path)) return false;
+    const ResponseRecord *records = log.records();
+    size_t n = log.size();
+    if (n == 0) return true;
+
+    // Split at attempt boundaries, at least 1M answers per thread
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, n / (1 << 20) + 1));
+    std::vector<size_t> bounds(1, 0);
+    for (size_t t = 1; t < threads; ++t) {
+        size_t cut = std::max(bounds.back(), n * t / threads);
+        while (cut < n && !(records[cut].flags & RESPONSE_FIRST)) ++cut;
+        bounds.push_back(cut);
+    }
+    bounds.push_back(n);
+
+    std::vector<std::vector<uint32_t>> answered(threads);
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(collectQuestionIds, records + bounds[t], records + bounds[t + 1], std::ref(answered[t]));
+    }
+    collectQuestionIds(records + bounds[0], records + bounds[1], answered[0]);
+    for (std::thread &t : pool) t.join();
+    pool.clear();
+    for (size_t t = 1; t < threads; ++t) answered[0].insert(answered[0].end(), answered[t].begin(), answered[t].end());
+    ItemRows itemRows;
+    itemRows.build(std::move(answered[0]));
+    answered.clear();
+
+    std::vector<ItemAnalysisPart> parts(threads);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(analyseResponseChunk, records + bounds[t], records + bounds[t + 1], std::cref(itemRows),
+                          std::ref(parts[t]));
+    }
+    analyseResponseChunk(records + bounds[0], records + bounds[1], itemRows, parts[0]);
+    for (std::thread &t : pool) t.join();
+    pool.clear();
+
+    size_t rows = itemRows.size();
+    ItemAnalysisPart total;
+    for (const ItemAnalysisPart &part : parts) {
+        total.attempts += part.attempts;
+        total.answers += part.answers;
+        total.scoreSum += part.scoreSum;
+        total.scoreSquares += part.scoreSquares;
+    }
+    total.sums.assign(rows * SUM_COLUMNS, 0);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(reduceItemSums, std::cref(parts), rows * t / threads, rows * (t + 1) / threads,
+                          std::ref(total.sums));
+    }
+    reduceItemSums(parts, 0, rows / threads, total.sums);
+    for (std::thread &t : pool) t.join();
+    parts.clear();
+
+    out.attempts = total.attempts;
+    out.answers = total.answers;
+    double attempts = (double)total.attempts;
+    out.meanScore = total.scoreSum / attempts;
+    out.scoreVariance = std::max(0.0, total.scoreSquares / attempts - out.meanScore * out.meanScore);
+
+    double itemVariance = 0;  // Summed over answers, to be averaged per answer
+    for (size_t i = 0; i < rows; ++i) {
+        const uint64_t *row = &total.sums[i * SUM_COLUMNS];
+        if (row[SUM_ANSWERS] == 0) continue;
+        double answers = (double)row[SUM_ANSWERS], correct = (double)row[SUM_CORRECT];
+        double rest = (double)row[SUM_REST], restSquares = (double)row[SUM_REST_SQUARES];
+
+        ItemStats s;
+        s.id = itemRows.ids[i];
+        s.answers = row[SUM_ANSWERS];
+        s.correct = row[SUM_CORRECT];
+        s.difficulty = correct / answers;
+        double cross = answers * row[SUM_REST_CORRECT] - correct * rest;
+        double spread = (answers * correct - correct * correct) * (answers * restSquares - rest * rest);
+        s.discrimination = spread > 0 ? cross / std::sqrt(spread) : 0;
+        for (int c = 0; c <= MAX_OPTIONS; ++c) s.choiceRates[c] = row[SUM_CHOICES + c] / answers;
+        out.items.push_back(s);
+        itemVariance += answers * s.difficulty * (1 - s.difficulty);
+    }
+
+    double k = (double)total.answers / attempts;
+    if (k > 1 && out.scoreVariance > 0) {
+        out.alpha = k / (k - 1) * (1 - k * (itemVariance / total.answers) / out.scoreVariance);
+    }
+    return true;
+}
+
+// Write the analysis as CSV, one question per row. The test summary comes
+// first on lines starting with '#'. Question texts are taken from 'bank'
+// when it is given.
+inline bool writeItemAnalysisCsv(const std::string &path, const ItemAnalysis &a, const QuestionBank *bank) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    out << std::fixed << std::setprecision(4);
+    out << "# attempts," << a.attempts << "\n# answers," << a.answers << "\n# mean_score," << a.meanScore
+        << "\n# score_variance," << a.scoreVariance << "\n# alpha," << a.alpha << "\n";
+    out << "id,question,answers,p_value,point_biserial,no_answer";
+    for (int c = 1; c <= MAX_OPTIONS; ++c) out << ",option_" << c;
+    out << "\n";
+    for (const ItemStats &s : a.items) {
+        std::string text;
+        QuestionRecord q;
+        if (bank && bank->find(s.id, q)) text = std::string(q.text);
+        std::string quoted = "\"";
+        for (char c : text) {
+            if (c == '"') quoted += '"';
+            quoted += c;
+        }
+        quoted += '"';
+        out << s.id << "," << quoted << "," << s.answers << "," << s.difficulty << "," << s.discrimination;
+        for (int c = 0; c <= MAX_OPTIONS; ++c) out << "," << s.choiceRates[c];
+        out << "\n";
+    }
+    return (bool)out;
+}
+
+#endif
@@ -0,0 +1,340 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+// Score-ordered leaderboard.
+//
+// leaderboard.txt stays the readable record of every result. leaderboard.idx
+// is a sorted index over it with two sections: every row ordered by score
+// (highest first, earlier rows first on ties), and every student ID with its
+// best score ordered by ID. Rows appended since the index was written form a
+// small sorted tail held in memory; once that tail reaches MAX_TAIL_ROWS rows,
+// the index is rewritten with one merge, so opening the leaderboard never
+// parses more than that many rows. Top-K, paging and rank lookups use binary
+// search on the two sections and read only the rows they return.
+//
+// Ranks are ranks of results, as the leaderboard lists every result: a row's
+// rank is one more than the number of rows with a higher score, so rows with
+// equal scores share a rank, and a student with several results can hold
+// several places.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "platform.h"
+
+struct LeaderboardEntry {
+    std::string name;
+    int id = 0;
+    int score = 0;
+    uint64_t rowOffset = 0;  // Where the row starts in leaderboard.txt
+};
+
+const char LEADERBOARD_MAGIC[8] = {'Q', 'U', 'I', 'Z', 'L', 'D', 'B', '\0'};
+const uint32_t LEADERBOARD_VERSION = 1;
+
+struct LeaderboardHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceSize;     // Bytes of leaderboard.txt covered by the index
+    uint64_t rowCount;       // Entries in the by-score section
+    uint64_t byScoreOffset;
+    uint64_t studentCount;   // Entries in the by-ID section
+    uint64_t byIdOffset;
+};
+
+struct ScoreEntry {
+    int32_t score;
+    int32_t id;
+    uint64_t rowOffset;
+};
+
+struct StudentBest {
+    int32_t id;
+    int32_t bestScore;
+};
+
+static_assert(sizeof(LeaderboardHeader) == 56, "LeaderboardHeader layout changed");
+static_assert(sizeof(ScoreEntry) == 16, "ScoreEntry layout changed");
+static_assert(sizeof(StudentBest) == 8, "StudentBest layout changed");
+
+// Append a row in the same layout Student::saveToLeaderboard writes
+inline void appendLeaderboardRow(std::string &out, const std::string &name, int id, int score) {
+    char numbers[32];
+    if (name.size() < 20) out.append(20 - name.size(), ' ');
+    out += name;
+    snprintf(numbers, sizeof(numbers), "%10d%10d\n", id, score);
+    out += numbers;
+}
+
+// Leaderboard order: higher score first, then the earlier result
+inline bool ranksBefore(const ScoreEntry &a, const ScoreEntry &b) {
+    if (a.score != b.score) return a.score > b.score;
+    return a.rowOffset < b.rowOffset;
+}
+
+// Parse a "name id score" row. The name may contain spaces, so the last two
+// fields are taken as ID and score and everything before them is the name.
+inline bool parseLeaderboardRow(const std::string &row, LeaderboardEntry &e) {
+    const char *blanks = " \t\r";
+    size_t scoreEnd = row.find_last_not_of(blanks);
+    if (scoreEnd == std::string::npos) return false;
+    size_t scoreStart = row.find_last_of(blanks, scoreEnd);
+    scoreStart = scoreStart == std::string::npos ? 0 : scoreStart + 1;
+    if (scoreStart == 0) return false;
+
+    size_t idEnd = row.find_last_not_of(blanks, scoreStart - 1);
+    if (idEnd == std::string::npos) return false;
+    size_t idStart = row.find_last_of(blanks, idEnd);
+    idStart = idStart == std::string::npos ? 0 : idStart + 1;
+
+    std::istringstream id(row.substr(idStart, idEnd - idStart + 1));
+    std::istringstream score(row.substr(scoreStart, scoreEnd - scoreStart + 1));
+    char extra;
+    if (!(id >> e.id) || (id >> extra) || !(score >> e.score) || (score >> extra)) return false;
+
+    size_t nameStart = row.find_first_not_of(blanks);
+    size_t nameEnd = idStart == 0 ? std::string::npos : row.find_last_not_of(blanks, idStart - 1);
+    if (nameStart == std::string::npos || nameEnd == std::string::npos || nameStart >= idStart) {
+        e.name.clear();
+    } else {
+        e.name = row.substr(nameStart, nameEnd - nameStart + 1);
+    }
+    return true;
+}
+
+class Leaderboard {
+private:
+    std::string textPath, indexPath;
+    std::ifstream rows;
+    MappedFile mapped;
+    FileLock lock;  // Taken shared while the rows are read, so a compaction is never seen half done
+
+    // Sorted sections, pointing into the mapped index or into the owned copies
+    const ScoreEntry *byScore = nullptr;
+    size_t rowCount = 0;
+    const StudentBest *byId = nullptr;
+    size_t studentCount = 0;
+    std::vector<ScoreEntry> ownedScores;
+    std::vector<StudentBest> ownedBest;
+    uint64_t coveredSize = 0;
+
+    // Rows appended after the index was written, kept sorted
+    std::vector<ScoreEntry> tail;
+    std::vector<StudentBest> tailBest;
+
+    static constexpr size_t MAX_TAIL_ROWS = 4096;
+
+    bool loadIndex() {
+        if (!mapped.open(indexPath) || mapped.size() < sizeof(LeaderboardHeader)) return false;
+        const LeaderboardHeader *h = reinterpret_cast<const LeaderboardHeader *>(mapped.data());
+        if (memcmp(h->magic, LEADERBOARD_MAGIC, sizeof(h->magic)) != 0 || h->version != LEADERBOARD_VERSION) return false;
+        if (h->byScoreOffset + h->rowCount * sizeof(ScoreEntry) > mapped.size() ||
+            h->byIdOffset + h->studentCount * sizeof(StudentBest) > mapped.size()) return false;
+
+        byScore = reinterpret_cast<const ScoreEntry *>(mapped.data() + h->byScoreOffset);
+        rowCount = (size_t)h->rowCount;
+        byId = reinterpret_cast<const StudentBest *>(mapped.data() + h->byIdOffset);
+        studentCount = (size_t)h->studentCount;
+        coveredSize = h->sourceSize;
+        return true;
+    }
+
+    void resetBase() {
+        mapped.close();
+        byScore = nullptr;
+        byId = nullptr;
+        rowCount = studentCount = 0;
+        coveredSize = 0;
+    }
+
+    static void mergeBest(std::vector<StudentBest> &best, const StudentBest &b) {
+        auto it = std::lower_bound(best.begin(), best.end(), b.id,
+                                   [](const StudentBest &x, int32_t id) { return x.id < id; });
+        if (it != best.end() && it->id == b.id) {
+            it->bestScore = std::max(it->bestScore, b.bestScore);
+        } else {
+            best.insert(it, b);
+        }
+    }
+
+    // Parse the rows from 'from' to the end of leaderboard.txt into the tail.
+    // Returns the offset just past the last complete row.
+    uint64_t readTail(uint64_t from) {
+        tail.clear();
+        tailBest.clear();
+        rows.clear();
+        rows.seekg((std::streamoff)from);
+        std::string row;
+        uint64_t offset = from;
+        while (std::getline(rows, row)) {
+            if (rows.eof()) break;  // Row still being written, leave it for next time
+            LeaderboardEntry e;
+            if (parseLeaderboardRow(row, e)) {
+                tail.push_back(ScoreEntry{e.score, e.id, offset});
+                tailBest.push_back(StudentBest{e.id, e.score});
+            }
+            offset += row.size() + 1;
+        }
+        std::sort(tail.begin(), tail.end(), ranksBefore);
+        std::sort(tailBest.begin(), tailBest.end(), [](const StudentBest &a, const StudentBest &b) {
+            return a.id != b.id ? a.id < b.id : a.bestScore > b.bestScore;
+        });
+        tailBest.erase(std::unique(tailBest.begin(), tailBest.end(),
+                                   [](const StudentBest &a, const StudentBest &b) { return a.id == b.id; }),
+                       tailBest.end());
+        return offset;
+    }
+
+    // Merge the tail into the sorted sections and write a new index
+    bool rebuild(uint64_t sourceSize) {
+        std::vector<ScoreEntry> scores(rowCount + tail.size());
+        std::merge(byScore, byScore + rowCount, tail.begin(), tail.end(), scores.begin(), ranksBefore);
+
+        std::vector<StudentBest> best(byId, byId + studentCount);
+        for (const StudentBest &b : tailBest) mergeBest(best, b);
+
+        LeaderboardHeader h = {};
+        memcpy(h.magic, LEADERBOARD_MAGIC, sizeof(h.magic));
+        h.version = LEADERBOARD_VERSION;
+        h.sourceSize = sourceSize;
+        h.rowCount = scores.size();
+        h.byScoreOffset = sizeof(LeaderboardHeader);
+        h.studentCount = best.size();
+        h.byIdOffset = h.byScoreOffset + scores.size() * sizeof(ScoreEntry);
+
+        std::string tmpPath = tempPathFor(indexPath);
+        bool saved;
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char *>(scores.data()), (std::streamsize)(scores.size() * sizeof(ScoreEntry)));
+            out.write(reinterpret_cast<const char *>(best.data()), (std::streamsize)(best.size() * sizeof(StudentBest)));
+            saved = (bool)out;
+        }
+        saved = saved && replaceFile(tmpPath, indexPath);
+
+        resetBase();
+        tail.clear();
+        tailBest.clear();
+        if (saved && loadIndex()) return true;
+
+        // Could not write the index; keep the merged sections in memory for now
+        ownedScores.swap(scores);
+        ownedBest.swap(best);
+        byScore = ownedScores.data();
+        rowCount = ownedScores.size();
+        byId = ownedBest.data();
+        studentCount = ownedBest.size();
+        coveredSize = sourceSize;
+        return false;
+    }
+
+    LeaderboardEntry readEntry(const ScoreEntry &s) {
+        LeaderboardEntry e;
+        rows.clear();
+        rows.seekg((std::streamoff)s.rowOffset);
+        std::string row;
+        if (std::getline(rows, row)) parseLeaderboardRow(row, e);
+        e.id = s.id;
+        e.score = s.score;
+        e.rowOffset = s.rowOffset;
+        return e;
+    }
+
+    // Number of entries in [first, first + n) that have a higher score than 'score'
+    static size_t countAbove(const ScoreEntry *first, size_t n, int score) {
+        return (size_t)(std::partition_point(first, first + n, [&](const ScoreEntry &e) { return e.score > score; }) - first);
+    }
+public:
+    Leaderboard() {}
+    Leaderboard(const Leaderboard &) = delete;
+    Leaderboard &operator=(const Leaderboard &) = delete;
+
+    bool open(const std::string &text, const std::string &index) {
+        textPath = text;
+        indexPath = index;
+        resetBase();
+        rows.close();
+        rows.clear();
+        rows.open(textPath, std::ios::binary);
+        if (!rows.is_open()) return false;
+
+        lock.open(textPath);
+        FileLockGuard guard(lock, false);
+        if (!loadIndex() || coveredSize > getFileInfo(textPath).size) {
+            resetBase();  // Missing, corrupt or for a different file: index everything again
+        }
+        uint64_t end = readTail(coveredSize);
+        if (tail.size() >= MAX_TAIL_ROWS) {
+            rebuild(end);
+        }
+        return true;
+    }
+
+    size_t size() const { return rowCount + tail.size(); }
+
+    // Entries at leaderboard positions [start, start + count)
+    std::vector<LeaderboardEntry> page(size_t start, size_t count) {
+        std::vector<LeaderboardEntry> out;
+        size_t n = rowCount, d = tail.size();
+        if (start >= n + d) return out;
+
+        // Find how many of the first 'start' entries come from the index
+        size_t lo = start > d ? start - d : 0, hi = std::min(start, n);
+        while (lo < hi) {
+            size_t i = (lo + hi) / 2, j = start - i;
+            if (j > 0 && ranksBefore(byScore[i], tail[j - 1])) {
+                lo = i + 1;
+            } else {
+                hi = i;
+            }
+        }
+
+        size_t i = lo, j = start - lo;
+        while (out.size() < count && (i < n || j < d)) {
+            if (j >= d || (i < n && ranksBefore(byScore[i], tail[j]))) {
+                out.push_back(readEntry(byScore[i++]));
+            } else {
+                out.push_back(readEntry(tail[j++]));
+            }
+        }
+        return out;
+    }
+
+    std::vector<LeaderboardEntry> top(size_t k) { return page(0, k); }
+
+    // Rank of a result with this score (1 = first place)
+    size_t rankOfScore(int score) const {
+        return 1 + countAbove(byScore, rowCount, score) + countAbove(tail.data(), tail.size(), score);
+    }
+
+    // Rank of a student's best result among all results
+    bool rankOf(int id, size_t &rank, int &bestScore) {
+        bool found = false;
+        const StudentBest *it = std::lower_bound(byId, byId + studentCount, id,
+                                                 [](const StudentBest &x, int32_t v) { return x.id < v; });
+        if (it != byId + studentCount && it->id == id) {
+            bestScore = it->bestScore;
+            found = true;
+        }
+        auto t = std::lower_bound(tailBest.begin(), tailBest.end(), id,
+                                  [](const StudentBest &x, int32_t v) { return x.id < v; });
+        if (t != tailBest.end() && t->id == id && (!found || t->bestScore > bestScore)) {
+            bestScore = t->bestScore;
+            found = true;
+        }
+        if (!found) return false;
+
+        rank = rankOfScore(bestScore);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MENU_H
+#define MENU_H
+
+// The main menu, shared by the interactive program and the server, so that a
+// number picks the same thing whichever one a student is using. The server
+// lists only the entries it can serve, under their usual numbers.
+
+#include <string>
+
+enum MenuChoice {
+    MENU_ADD_QUESTION = 1,
+    MENU_START_QUIZ,
+    MENU_LEADERBOARD,
+    MENU_QUESTION_STATS,
+    MENU_COMPILE_BANK,
+    MENU_RANDOM_QUIZ,
+    MENU_ADAPTIVE_QUIZ,
+    MENU_TIMINGS,
+    MENU_EXIT  // Always the last entry
+};
+
+struct MenuItem {
+    MenuChoice choice;
+    const char *label;
+    bool served;  // Offered by the server too
+};
+
+const MenuItem MAIN_MENU[] = {
+    {MENU_ADD_QUESTION, "Add a Question", false},
+    {MENU_START_QUIZ, "Start the Quiz", true},
+    {MENU_LEADERBOARD, "View Leaderboard", true},
+    {MENU_QUESTION_STATS, "View Question Statistics", false},
+    {MENU_COMPILE_BANK, "Compile Question Bank", false},
+    {MENU_RANDOM_QUIZ, "Start a Random Quiz", true},
+    {MENU_ADAPTIVE_QUIZ, "Start an Adaptive Quiz", false},
+    {MENU_TIMINGS, "Show Timings", false},
+    {MENU_EXIT, "Exit", true},
+};
+
+// "2. Start the Quiz"
+inline std::string menuEntry(const MenuItem &item) {
+    return std::to_string((int)item.choice) + ". " + item.label;
+}
+
+#endif
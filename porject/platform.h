@@ -0,0 +1,536 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Small wrappers around the few OS calls the quiz engine needs, so the rest
+// of the code does not have to care whether it runs on Windows or Linux.
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <csignal>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// Size and modification time of a file, used to tell if a derived file is stale
+struct FileInfo {
+    bool exists = false;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+};
+
+inline FileInfo getFileInfo(const std::string &path) {
+    FileInfo info;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        info.exists = true;
+        info.size = (uint64_t)st.st_size;
+        info.mtime = (int64_t)st.st_mtime;
+    }
+    return info;
+}
+
+// Replace dst with src in one step (used after writing a temp file)
+inline bool replaceFile(const std::string &src, const std::string &dst) {
+#ifdef _WIN32
+    return MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(src.c_str(), dst.c_str()) == 0;
+#endif
+}
+
+// Create a directory; succeeds if it is already there
+inline bool makeDirectory(const std::string &path) {
+#ifdef _WIN32
+    if (CreateDirectoryA(path.c_str(), NULL) != 0) return true;
+#else
+    if (mkdir(path.c_str(), 0755) == 0) return true;
+#endif
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && (st.st_mode & S_IFDIR) != 0;
+}
+
+// A temp file name next to 'path' that no other process will pick
+inline std::string tempPathFor(const std::string &path) {
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = (unsigned long)getpid();
+#endif
+    return path + "." + std::to_string(pid) + ".tmp";
+}
+
+// Make a rename inside the directory of 'path' survive a crash (a no-op on
+// Windows, where the rename itself is durable once it returns)
+inline void syncDirectoryOf(const std::string &path) {
+#ifndef _WIN32
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+// Unbuffered file for reading and writing at given offsets, with fsync.
+// Not safe to share between threads without a lock.
+class RawFile {
+private:
+    int fd = -1;
+
+    bool seek(uint64_t offset) {
+#ifdef _WIN32
+        return _lseeki64(fd, (__int64)offset, SEEK_SET) >= 0;
+#else
+        return lseek(fd, (off_t)offset, SEEK_SET) >= 0;
+#endif
+    }
+public:
+    RawFile() {}
+    RawFile(const RawFile &) = delete;
+    RawFile &operator=(const RawFile &) = delete;
+    ~RawFile() { close(); }
+
+    // Open for reading and writing, creating the file if it is missing
+    bool open(const std::string &path) {
+        close();
+#ifdef _WIN32
+        fd = _open(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+#endif
+        return fd >= 0;
+    }
+
+    void close() {
+        if (fd < 0) return;
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+        fd = -1;
+    }
+
+    bool isOpen() const { return fd >= 0; }
+
+    uint64_t size() const {
+        struct stat st;
+        return fd >= 0 && fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    }
+
+    bool readAt(uint64_t offset, void *buffer, size_t length) {
+        if (!seek(offset)) return false;
+        char *p = (char *)buffer;
+        while (length > 0) {
+#ifdef _WIN32
+            int n = _read(fd, p, (unsigned)length);
+#else
+            ssize_t n = ::read(fd, p, length);
+            if (n < 0 && errno == EINTR) continue;
+#endif
+            if (n <= 0) return false;
+            p += n;
+            length -= (size_t)n;
+        }
+        return true;
+    }
+
+    bool writeAt(uint64_t offset, const void *buffer, size_t length) {
+        if (!seek(offset)) return false;
+        const char *p = (const char *)buffer;
+        while (length > 0) {
+#ifdef _WIN32
+            int n = _write(fd, p, (unsigned)length);
+#else
+            ssize_t n = ::write(fd, p, length);
+            if (n < 0 && errno == EINTR) continue;
+#endif
+            if (n <= 0) return false;
+            p += n;
+            length -= (size_t)n;
+        }
+        return true;
+    }
+
+    bool truncate(uint64_t length) {
+#ifdef _WIN32
+        return _chsize_s(fd, (__int64)length) == 0;
+#else
+        return ftruncate(fd, (off_t)length) == 0;
+#endif
+    }
+
+    // Wait until everything written is on the disk
+    bool sync() {
+#ifdef _WIN32
+        return _commit(fd) == 0;
+#else
+        return fsync(fd) == 0;
+#endif
+    }
+};
+
+// Advisory lock shared between processes: any number of shared holders or
+// one exclusive holder. It is taken on '<file>.lock' rather than the file
+// itself, so it still works when the file is replaced by a rename.
+class FileLock {
+private:
+#ifdef _WIN32
+    HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+    int fd = -1;
+#endif
+
+    bool lock(bool exclusive) {
+#ifdef _WIN32
+        if (handle == INVALID_HANDLE_VALUE) return false;
+        OVERLAPPED range = {};
+        return LockFileEx(handle, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &range) != 0;
+#else
+        if (fd < 0) return false;
+        while (flock(fd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+            if (errno != EINTR) return false;
+        }
+        return true;
+#endif
+    }
+public:
+    FileLock() {}
+    FileLock(const FileLock &) = delete;
+    FileLock &operator=(const FileLock &) = delete;
+    ~FileLock() { close(); }
+
+    bool open(const std::string &path) {
+        close();
+        std::string lockPath = path + ".lock";
+#ifdef _WIN32
+        handle = CreateFileA(lockPath.c_str(), GENERIC_READ | GENERIC_WRITE,
+                             FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+        return handle != INVALID_HANDLE_VALUE;
+#else
+        fd = ::open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+        return fd >= 0;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle);
+        handle = INVALID_HANDLE_VALUE;
+#else
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
+
+    bool lockShared() { return lock(false); }
+    bool lockExclusive() { return lock(true); }
+
+    void unlock() {
+#ifdef _WIN32
+        OVERLAPPED range = {};
+        if (handle != INVALID_HANDLE_VALUE) UnlockFileEx(handle, 0, 1, 0, &range);
+#else
+        if (fd >= 0) flock(fd, LOCK_UN);
+#endif
+    }
+};
+
+// Holds a FileLock until the end of the scope. A lock file that cannot be
+// created (say, a read-only directory) leaves the caller unlocked, as before
+// locking existed.
+class FileLockGuard {
+private:
+    FileLock &lock;
+    bool held;
+public:
+    FileLockGuard(FileLock &l, bool exclusive) : lock(l) {
+        held = exclusive ? lock.lockExclusive() : lock.lockShared();
+    }
+    FileLockGuard(const FileLockGuard &) = delete;
+    FileLockGuard &operator=(const FileLockGuard &) = delete;
+    ~FileLockGuard() {
+        if (held) lock.unlock();
+    }
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+private:
+    const char *ptr = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mapHandle = NULL;
+#endif
+public:
+    MappedFile() {}
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const std::string &path) {
+        close();
+#ifdef _WIN32
+        fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapHandle == NULL) {
+            close();
+            return false;
+        }
+        ptr = (const char *)MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0);
+        if (ptr == nullptr) {
+            close();
+            return false;
+        }
+        length = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // The mapping stays valid after the descriptor is closed
+        if (p == MAP_FAILED) return false;
+        ptr = (const char *)p;
+        length = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapHandle) CloseHandle(mapHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        mapHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+#else
+        if (ptr) munmap((void *)ptr, length);
+#endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+    const char *data() const { return ptr; }
+    size_t size() const { return length; }
+    bool isOpen() const { return ptr != nullptr; }
+};
+
+// Tells whether one file was written, replaced or removed, without a stat
+// call per check. Uses inotify on the file's directory, so a file replaced by
+// a rename is still followed. Where inotify is not available watch() returns
+// false and the caller has to compare sizes and times itself. changed() may
+// be called from several threads at once.
+class FileWatcher {
+private:
+#ifdef __linux__
+    int fd = -1;
+    std::atomic<bool> lost{false};
+#endif
+    std::string name;
+public:
+    FileWatcher() {}
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+    ~FileWatcher() { close(); }
+
+    bool watch(const std::string &path) {
+        close();
+#ifdef __linux__
+        size_t slash = path.find_last_of('/');
+        std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        name = slash == std::string::npos ? path : path.substr(slash + 1);
+        lost = false;
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+        uint32_t events = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                          IN_DELETE_SELF | IN_MOVE_SELF;
+        if (inotify_add_watch(fd, dir.c_str(), events) < 0) {
+            close();
+            return false;
+        }
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    bool isWatching() const {
+#ifdef __linux__
+        return fd >= 0;
+#else
+        return false;
+#endif
+    }
+
+    // True if the file changed since the last call. Also true if events were
+    // dropped or the directory itself went away, to be safe.
+    bool changed() {
+#ifdef __linux__
+        if (fd < 0) return true;
+        bool hit = false;
+        alignas(inotify_event) char buffer[4096];
+        while (true) {
+            ssize_t n = read(fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            for (ssize_t pos = 0; pos < n;) {
+                const inotify_event *e = reinterpret_cast<const inotify_event *>(buffer + pos);
+                if (e->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    lost = true;  // The watch is gone; report a change on every call from now on
+                } else if (e->mask & IN_Q_OVERFLOW) {
+                    hit = true;
+                } else if (e->len > 0 && name == e->name) {
+                    hit = true;
+                }
+                pos += (ssize_t)(sizeof(inotify_event) + e->len);
+            }
+        }
+        return hit || lost;
+#else
+        return true;
+#endif
+    }
+
+    void close() {
+#ifdef __linux__
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+    }
+};
+
+#ifndef _WIN32
+// Block every signal that a thread of this program takes with sigwait() or a
+// signalfd: SIGINT and SIGTERM (onTerminationSignal() and the server) and
+// SIGUSR1 (the timing report). If any thread left one of them unblocked the
+// kernel could hand it to that thread, which would die of it the default way.
+// The helpers that start a signal thread call this first, so whichever of
+// them runs first, before any other thread starts, every thread inherits all
+// of them blocked.
+inline void blockWaitedSignals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
+#endif
+
+// Cleanup to run on SIGINT or SIGTERM, until the TerminationHook returned by
+// onTerminationSignal() goes away. It waits for a cleanup that is running.
+class TerminationHook {
+public:
+    struct State {
+        std::mutex lock;
+        std::function<void()> cleanup;
+    };
+
+    TerminationHook() = default;
+    explicit TerminationHook(std::shared_ptr<State> s) : state(std::move(s)) {}
+    TerminationHook(TerminationHook &&) = default;
+    TerminationHook &operator=(TerminationHook &&other) {
+        disarm();
+        state = std::move(other.state);
+        return *this;
+    }
+    ~TerminationHook() { disarm(); }
+
+    // From now on the signals end the process without the cleanup
+    void disarm() {
+        if (!state) return;
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->cleanup = nullptr;
+        state.reset();
+    }
+
+    // Run the cleanup, unless the hook is gone
+    static void run(State &s) {
+        std::lock_guard<std::mutex> guard(s.lock);
+        if (s.cleanup) s.cleanup();
+    }
+private:
+    std::shared_ptr<State> state;
+};
+
+// Run 'cleanup' when the process gets SIGINT or SIGTERM, then let the signal
+// end the process as it would have. The signals go to a thread of their own
+// through sigwait(), so 'cleanup' may take locks and write files. Call before
+// any other thread starts (see blockWaitedSignals()), and keep the returned
+// hook no longer than what 'cleanup' uses. (Windows runs a SIGINT handler on
+// a thread of its own anyway.)
+inline TerminationHook onTerminationSignal(std::function<void()> cleanup) {
+    std::shared_ptr<TerminationHook::State> state = std::make_shared<TerminationHook::State>();
+    state->cleanup = std::move(cleanup);
+#ifdef _WIN32
+    static std::shared_ptr<TerminationHook::State> handler;
+    handler = state;
+    void (*run)(int) = [](int sig) {
+        TerminationHook::run(*handler);
+        std::signal(sig, SIG_DFL);
+        std::raise(sig);
+    };
+    std::signal(SIGINT, run);
+    std::signal(SIGTERM, run);
+#else
+    blockWaitedSignals();
+    std::thread([state] {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGINT);
+        sigaddset(&set, SIGTERM);
+        int sig;
+        if (sigwait(&set, &sig) != 0) return;
+        TerminationHook::run(*state);
+        sigset_t one;
+        sigemptyset(&one);
+        sigaddset(&one, sig);
+        signal(sig, SIG_DFL);
+        pthread_sigmask(SIG_UNBLOCK, &one, nullptr);
+        raise(sig);  // Sent to this thread, the only one not blocking it
+    }).detach();
+#endif
+    return TerminationHook(state);
+}
+
+#endif
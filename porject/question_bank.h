@@ -0,0 +1,942 @@
+#ifndef QUESTION_BANK_H
+#define QUESTION_BANK_H
+
+// Question bank storage.
+//
+// questions.txt stays the authoring format (the "MCQ"/"TF" tagged records
+// written by the admin menu). It can be compiled into a binary bank with a
+// fixed header, an offset table with one entry per question and a string
+// pool holding the texts. The quiz engine maps the compiled file and reads
+// questions straight out of it; when there is no compiled bank, or it was
+// built from a different version of questions.txt, the text file is parsed
+// into the same in-memory layout instead.
+//
+// Every question has a stable 32-bit ID, the key for its statistics and
+// logged answers. New records carry it on their tag line ("MCQ 42"), given
+// out when the record is appended. A record without one, as written before
+// IDs were stored, has the ID it always had: its 1-based position in the
+// bank. assignQuestionIds() writes those onto the tag lines, after which
+// records can be edited, removed or reordered by hand without any question
+// losing its history.
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "platform.h"
+
+const int MAX_OPTIONS = 4;
+
+enum QuestionType { QUESTION_MCQ = 1, QUESTION_TF = 2 };
+
+// One question as seen by the quiz engine. The views point into the bank and
+// stay valid as long as the bank they came from.
+struct QuestionRecord {
+    uint32_t id = 0;  // Stable question ID, the key for statistics and lookups
+    int type = QUESTION_MCQ;
+    std::string_view text;
+    std::string_view options[MAX_OPTIONS];
+    int numOptions = 0;
+    int correctAnswer = 0;
+};
+
+// Append q to 'out' as a questions.txt record, leaving out its ID (see
+// appendQuestionRecords), so equal questions format the same
+inline void formatQuestionRecord(std::string &out, const QuestionRecord &q) {
+    out += q.type == QUESTION_TF ? "TF\n" : "MCQ\n";
+    out += q.text;
+    out += '\n';
+    for (int i = 0; i < q.numOptions; ++i) {
+        out += q.options[i];
+        out += '\n';
+    }
+    char digits[16];
+    std::to_chars_result r = std::to_chars(digits, digits + sizeof(digits), q.correctAnswer);
+    out.append(digits, r.ptr);
+    out += '\n';
+}
+
+// getline that also drops the '\r' of files written on Windows
+inline bool readBankLine(std::istream &in, std::string &line) {
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    return true;
+}
+
+// --- Parsing questions.txt ---
+//
+// The parser works on the file mapped into memory and hands out records
+// whose strings point into the mapping, so nothing is copied or allocated
+// per question. Lines may end in "\n" or "\r\n". Tag and answer lines may
+// carry spaces around them; question and option texts are kept as written.
+// Lines outside a record are skipped, as they always have been. A record
+// whose answer line is not a number is reported with its byte offset and
+// skipped, and parsing carries on with the line after its tag.
+
+struct BankParseError {
+    uint64_t offset;      // Byte offset of the record's tag line
+    const char *message;
+};
+
+inline std::string_view trimBankField(std::string_view s) {
+    size_t first = s.find_first_not_of(" \t");
+    if (first == std::string_view::npos) return std::string_view();
+    return s.substr(first, s.find_last_not_of(" \t") - first + 1);
+}
+
+// Kind of record a tag line starts, or 0 if the line is not a tag. A tag
+// may carry the question's ID ("MCQ 42"), which goes to 'id' (0 if none).
+inline int bankRecordTag(std::string_view line, uint32_t *id = nullptr) {
+    line = trimBankField(line);
+    size_t space = line.find_first_of(" \t");
+    std::string_view word = line.substr(0, space);
+    int type = word == "MCQ" ? QUESTION_MCQ : word == "TF" ? QUESTION_TF : 0;
+    uint32_t value = 0;
+    if (type != 0 && space != std::string_view::npos) {
+        std::string_view digits = trimBankField(line.substr(space));
+        std::from_chars_result r = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+        if (r.ec != std::errc() || r.ptr != digits.data() + digits.size() || value == 0) return 0;
+    }
+    if (type != 0 && id) *id = value;
+    return type;
+}
+
+inline bool parseBankAnswer(std::string_view line, int &answer) {
+    line = trimBankField(line);
+    const char *last = line.data() + line.size();
+    std::from_chars_result r = std::from_chars(line.data(), last, answer);
+    return r.ec == std::errc() && r.ptr == last && !line.empty();
+}
+
+class QuestionTextParser {
+private:
+    const char *begin;
+    const char *pos;
+    const char *end;
+    uint64_t stopOffset = UINT64_MAX;
+    std::vector<BankParseError> *errors;
+
+    bool nextLine(std::string_view &line) {
+        if (pos >= end) return false;
+        const char *newline = static_cast<const char *>(memchr(pos, '\n', (size_t)(end - pos)));
+        const char *stop = newline ? newline : end;
+        size_t length = (size_t)(stop - pos);
+        if (length > 0 && stop[-1] == '\r') --length;
+        line = std::string_view(pos, length);
+        pos = newline ? newline + 1 : end;
+        return true;
+    }
+
+    void report(uint64_t offset, const char *message) {
+        if (errors) errors->push_back(BankParseError{offset, message});
+    }
+public:
+    // Parse data[from, size); 'from' must be the start of a line
+    QuestionTextParser(const char *data, size_t size, size_t from = 0, std::vector<BankParseError> *errorsOut = nullptr)
+        : begin(data), pos(data + (from < size ? from : size)), end(data + size), errors(errorsOut) {}
+
+    uint64_t offset() const { return (uint64_t)(pos - begin); }
+
+    // End before the first record whose tag line starts at or after 'stop',
+    // leaving offset() at that tag
+    void stopAtTag(uint64_t stop) { stopOffset = stop; }
+
+    // Move to the next tag line without reading its record. Returns its
+    // offset, or the end of the data if there is none.
+    uint64_t skipToTag() {
+        std::string_view line;
+        while (true) {
+            const char *start = pos;
+            if (!nextLine(line)) return offset();
+            if (bankRecordTag(line) != 0) {
+                pos = start;
+                return offset();
+            }
+        }
+    }
+
+    // The next record, or false at the end of the data. q.id is the ID on the
+    // tag line, or 0 when it has none. If recordStart is given it receives
+    // the byte offset of the tag line.
+    bool next(QuestionRecord &q, uint64_t *recordStart = nullptr) {
+        std::string_view line;
+        while (true) {
+            uint64_t start = offset();
+            if (!nextLine(line)) return false;
+            uint32_t id;
+            int type = bankRecordTag(line, &id);
+            if (type == 0) continue;
+            if (start >= stopOffset) {
+                pos = begin + start;
+                return false;
+            }
+
+            const char *afterTag = pos;
+            q = QuestionRecord();
+            q.id = id;
+            q.type = type;
+            q.numOptions = type == QUESTION_MCQ ? MAX_OPTIONS : 0;
+            bool complete = nextLine(q.text);
+            for (int i = 0; complete && i < q.numOptions; ++i) complete = nextLine(q.options[i]);
+            if (!complete || !nextLine(line)) {
+                report(start, "record is cut short by the end of the file");
+                return false;
+            }
+            if (!parseBankAnswer(line, q.correctAnswer)) {
+                report(start, "answer line is not a number");
+                pos = afterTag;  // The record's lines may hold the next tag
+                continue;
+            }
+            if (recordStart) *recordStart = start;
+            return true;
+        }
+    }
+};
+
+// --- Shared access to questions.txt ---
+//
+// Several quiz processes may share one questions.txt. A writer appends a
+// whole record with one write while holding the exclusive lock; a reader
+// holds the shared lock only long enough to read the file size. The file is
+// only ever appended to, so everything before that size is a consistent
+// snapshot that stays valid after the lock is released, and a reader never
+// waits longer than one record append.
+
+// Size and modification time of questions.txt, taken between appends
+inline FileInfo snapshotBank(const std::string &textPath) {
+    FileLock lock;
+    lock.open(textPath);
+    FileLockGuard guard(lock, false);
+    return getFileInfo(textPath);
+}
+
+// --- Compiled bank file format ---
+
+const char BANK_MAGIC[8] = {'Q', 'U', 'I', 'Z', 'B', 'N', 'K', '\0'};
+const uint32_t BANK_VERSION = 2;  // 2: entries carry the question ID
+
+struct BankHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;          // Number of questions
+    uint64_t sourceSize;     // Size of questions.txt this bank was built from
+    int64_t sourceMtime;     // Modification time of that questions.txt
+    uint64_t entriesOffset;  // File offset of the offset table
+    uint64_t poolOffset;     // File offset of the string pool
+    uint64_t poolSize;
+    uint64_t reserved;
+};
+
+struct BankEntry {
+    uint64_t textOffset;                 // Offset of the question text in the pool
+    uint32_t textLength;
+    uint32_t optionLength[MAX_OPTIONS];  // Options are stored right after the text
+    int32_t correctAnswer;
+    uint8_t type;
+    uint8_t numOptions;
+    uint16_t reserved;
+    uint32_t id;                         // 0 in a builder for "position in the bank"
+};
+
+static_assert(sizeof(BankHeader) == 64, "BankHeader layout changed");
+static_assert(sizeof(BankEntry) == 40, "BankEntry layout changed");
+
+// Collects questions and lays them out in the compiled format
+class BankBuilder {
+private:
+    std::vector<BankEntry> entries;
+    std::string pool;
+public:
+    // 'id' 0 means the question's position in the finished bank
+    void add(uint32_t id, int type, std::string_view text, const std::string_view options[], int numOptions,
+             int correctAns) {
+        BankEntry e = {};
+        e.id = id;
+        e.textOffset = pool.size();
+        e.textLength = (uint32_t)text.size();
+        pool.append(text.data(), text.size());
+        for (int i = 0; i < numOptions && i < MAX_OPTIONS; ++i) {
+            e.optionLength[i] = (uint32_t)options[i].size();
+            pool.append(options[i].data(), options[i].size());
+        }
+        e.correctAnswer = correctAns;
+        e.type = (uint8_t)type;
+        e.numOptions = (uint8_t)(numOptions < MAX_OPTIONS ? numOptions : MAX_OPTIONS);
+        entries.push_back(e);
+    }
+
+    // The texts of 'bytes' of questions.txt never need more pool than that
+    void reservePool(size_t bytes) { pool.reserve(pool.size() + bytes); }
+
+    // Add questions already laid out by another bank, with the pool they point into
+    void addLaidOut(const BankEntry *from, size_t count, const char *fromPool, size_t fromPoolSize) {
+        // Room for a few more questions, which usually follow
+        uint64_t shift = pool.size();
+        pool.reserve(pool.size() + fromPoolSize + fromPoolSize / 16);
+        pool.append(fromPool, fromPoolSize);
+        entries.reserve(entries.size() + count + count / 16);
+        for (size_t i = 0; i < count; ++i) {
+            entries.push_back(from[i]);
+            entries.back().textOffset += shift;
+        }
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // Header, offset table and pool as one contiguous block
+    std::vector<char> image(const FileInfo &source) const {
+        return image(std::vector<const BankBuilder *>(1, this), source);
+    }
+
+    // The questions of several builders, one after the other, as one image.
+    // Each builder's part is copied on its own thread.
+    static std::vector<char> image(const std::vector<const BankBuilder *> &parts, const FileInfo &source) {
+        std::vector<uint64_t> firstEntry(1, 0), poolStart(1, 0);
+        for (const BankBuilder *b : parts) {
+            firstEntry.push_back(firstEntry.back() + b->entries.size());
+            poolStart.push_back(poolStart.back() + b->pool.size());
+        }
+
+        BankHeader h = {};
+        memcpy(h.magic, BANK_MAGIC, sizeof(h.magic));
+        h.version = BANK_VERSION;
+        h.count = (uint32_t)firstEntry.back();
+        h.sourceSize = source.size;
+        h.sourceMtime = source.mtime;
+        h.entriesOffset = sizeof(BankHeader);
+        h.poolOffset = h.entriesOffset + firstEntry.back() * sizeof(BankEntry);
+        h.poolSize = poolStart.back();
+
+        std::vector<char> out(h.poolOffset + h.poolSize);
+        memcpy(out.data(), &h, sizeof(h));
+        auto copyPart = [&](size_t p) {
+            const BankBuilder &b = *parts[p];
+            BankEntry *to = reinterpret_cast<BankEntry *>(out.data() + h.entriesOffset) + firstEntry[p];
+            for (size_t i = 0; i < b.entries.size(); ++i) {
+                to[i] = b.entries[i];
+                to[i].textOffset += poolStart[p];
+                if (to[i].id == 0) to[i].id = (uint32_t)(firstEntry[p] + i + 1);
+            }
+            if (!b.pool.empty()) memcpy(out.data() + h.poolOffset + poolStart[p], b.pool.data(), b.pool.size());
+        };
+        std::vector<std::thread> pool;
+        for (size_t p = 1; p < parts.size(); ++p) pool.emplace_back(copyPart, p);
+        if (!parts.empty()) copyPart(0);
+        for (std::thread &t : pool) t.join();
+        return out;
+    }
+};
+
+// --- Parallel parsing ---
+//
+// A large questions.txt is cut into one chunk per core. Each chunk starts at
+// the first tag line after its cut and parses up to the first tag line after
+// the next cut, where the following chunk takes over. A tag-like line can
+// also be a question or option text ("TF" as an option), so a chunk's start
+// is only a guess: it is right if the chunk before it stopped at the same
+// tag. A chunk that guessed wrong is parsed again from where the one before
+// it stopped, so the result is always the sequential parser's.
+
+struct BankChunk {
+    uint64_t start = 0;  // Offset of the chunk's first tag line
+    uint64_t stop = 0;   // Records whose tags start here or later belong to the next chunk
+    uint64_t next = 0;   // Where the parser actually stopped
+    BankBuilder builder;
+    std::vector<BankParseError> errors;
+};
+
+inline void parseBankChunk(const char *data, size_t size, BankChunk &c) {
+    c.builder = BankBuilder();
+    c.errors.clear();
+    if (c.stop > c.start) c.builder.reservePool((size_t)(c.stop - c.start));
+    QuestionTextParser parser(data, size, (size_t)c.start, &c.errors);
+    parser.stopAtTag(c.stop);
+    QuestionRecord q;
+    while (parser.next(q)) {
+        c.builder.add(q.id, q.type, q.text, q.options, q.numOptions, q.correctAnswer);
+    }
+    c.next = parser.offset();
+}
+
+// Parse data[from, size) on 'threads' cores (0 = all) into chunks in file order
+inline void parseBankParallel(const char *data, size_t size, size_t from, std::vector<BankChunk> &chunks,
+                              size_t threads = 0) {
+    // At least 4 MB per chunk; below that a thread costs more than it saves
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, (size - std::min(from, size)) / (4 << 20) + 1));
+    chunks.assign(threads, BankChunk());
+    std::vector<uint64_t> cuts;
+    for (size_t t = 0; t <= threads; ++t) cuts.push_back(from + (uint64_t)(size - std::min(from, size)) * t / threads);
+
+    for (size_t t = 0; t < threads; ++t) {
+        uint64_t at = cuts[t];
+        if (at > from && at < size && data[at - 1] != '\n') {
+            const char *nl = (const char *)memchr(data + at, '\n', (size_t)(size - at));
+            at = nl ? (uint64_t)(nl - data) + 1 : size;
+        }
+        chunks[t].start = t == 0 ? from : QuestionTextParser(data, size, (size_t)at).skipToTag();
+        chunks[t].stop = t + 1 < threads ? cuts[t + 1] : size;
+    }
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) pool.emplace_back(parseBankChunk, data, size, std::ref(chunks[t]));
+    parseBankChunk(data, size, chunks[0]);
+    for (std::thread &t : pool) t.join();
+
+    for (size_t t = 1; t < threads; ++t) {
+        if (chunks[t].start != chunks[t - 1].next) {
+            chunks[t].start = chunks[t - 1].next;  // Guessed inside a record
+            parseBankChunk(data, size, chunks[t]);
+        }
+    }
+}
+
+// Read-only view of a bank, either mapped from a compiled file or built in memory
+class QuestionBank {
+private:
+    MappedFile mapped;
+    std::vector<char> owned;
+    const char *base = nullptr;
+    size_t length = 0;
+    bool compiled = false;
+
+    // Ordinal + 1 of every ID, built on the first lookup: a table indexed by
+    // ID when the IDs are dense, as they are unless questions were removed
+    // by hand, and a hash map otherwise
+    mutable std::mutex lookupLock;
+    mutable std::atomic<bool> lookupBuilt{false};
+    mutable std::vector<uint32_t> byId;
+    mutable std::unordered_map<uint32_t, uint32_t> bySparseId;
+    mutable size_t duplicates = 0;
+    mutable uint32_t highest = 0;
+
+    const BankHeader &header() const { return *reinterpret_cast<const BankHeader *>(base); }
+    const BankEntry *entries() const { return reinterpret_cast<const BankEntry *>(base + header().entriesOffset); }
+
+    void buildLookup() const {
+        std::lock_guard<std::mutex> guard(lookupLock);
+        if (lookupBuilt.load(std::memory_order_relaxed)) return;
+        size_t n = size();
+        highest = 0;
+        for (size_t i = 0; i < n; ++i) highest = std::max(highest, entries()[i].id);
+        duplicates = 0;
+        if (highest <= 2 * n + 1024) {
+            byId.assign((size_t)highest + 1, 0);
+            for (size_t i = 0; i < n; ++i) {
+                uint32_t &slot = byId[entries()[i].id];
+                if (slot == 0) slot = (uint32_t)(i + 1);
+                else duplicates++;
+            }
+        } else {
+            bySparseId.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                if (!bySparseId.emplace(entries()[i].id, (uint32_t)(i + 1)).second) duplicates++;
+            }
+        }
+        lookupBuilt.store(true, std::memory_order_release);
+    }
+
+    static bool validImage(const char *data, size_t size) {
+        if (size < sizeof(BankHeader)) return false;
+        const BankHeader *h = reinterpret_cast<const BankHeader *>(data);
+        if (memcmp(h->magic, BANK_MAGIC, sizeof(h->magic)) != 0 || h->version != BANK_VERSION) return false;
+        if (h->entriesOffset < sizeof(BankHeader) || h->entriesOffset % 8 != 0) return false;
+        if (h->entriesOffset + (uint64_t)h->count * sizeof(BankEntry) > h->poolOffset) return false;
+        return h->poolOffset <= size && h->poolSize <= size - h->poolOffset;
+    }
+
+    void useImage(const char *data, size_t size) {
+        base = data;
+        length = size;
+        std::lock_guard<std::mutex> guard(lookupLock);
+        lookupBuilt.store(false, std::memory_order_relaxed);
+        byId.clear();
+        bySparseId.clear();
+    }
+public:
+    QuestionBank() {}
+    QuestionBank(const QuestionBank &) = delete;
+    QuestionBank &operator=(const QuestionBank &) = delete;
+
+    // Parse the text bank the same way the interactive quiz always has,
+    // from the record starting at 'from' up to 'limit' (the size of a snapshot)
+    static bool parseText(const std::string &path, BankBuilder &builder, uint64_t limit, uint64_t from = 0,
+                          std::vector<BankParseError> *errors = nullptr) {
+        MappedFile file;
+        if (!file.open(path)) {
+            FileInfo info = getFileInfo(path);
+            return info.exists && info.size == 0;  // An empty file cannot be mapped, but is an empty bank
+        }
+        size_t size = (size_t)std::min<uint64_t>(limit, file.size());
+        if (size > from) builder.reservePool(size - (size_t)from);
+        QuestionTextParser parser(file.data(), size, (size_t)from, errors);
+        QuestionRecord q;
+        while (parser.next(q)) {
+            builder.add(q.id, q.type, q.text, q.options, q.numOptions, q.correctAnswer);
+        }
+        return true;
+    }
+
+    // Parse the text bank as it was at 'source' on 'threads' cores (0 = all)
+    // straight into the compiled layout
+    static bool parseTextImage(const std::string &path, const FileInfo &source, std::vector<char> &image,
+                               std::vector<BankParseError> *errors = nullptr, size_t threads = 0) {
+        MappedFile file;
+        std::vector<BankChunk> chunks;
+        if (file.open(path)) {
+            parseBankParallel(file.data(), (size_t)std::min<uint64_t>(source.size, file.size()), 0, chunks, threads);
+        } else if (!getFileInfo(path).exists) {
+            return false;
+        }
+        std::vector<const BankBuilder *> parts;
+        for (const BankChunk &c : chunks) {
+            parts.push_back(&c.builder);
+            if (errors) errors->insert(errors->end(), c.errors.begin(), c.errors.end());
+        }
+        image = BankBuilder::image(parts, source);
+        return true;
+    }
+
+    // Compile the text bank into the binary format (written to a temp file and
+    // renamed). Malformed records are skipped and listed in 'errors'.
+    static bool compile(const std::string &textPath, const std::string &compiledPath, size_t *count = nullptr,
+                        std::vector<BankParseError> *errors = nullptr) {
+        FileInfo source = snapshotBank(textPath);
+        std::vector<char> image;
+        if (!source.exists || !parseTextImage(textPath, source, image, errors)) return false;
+        std::string tmpPath = tempPathFor(compiledPath);
+        {
+            std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) return false;
+            out.write(image.data(), (std::streamsize)image.size());
+            if (!out) return false;
+        }
+        if (!replaceFile(tmpPath, compiledPath)) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        if (count) *count = reinterpret_cast<const BankHeader *>(image.data())->count;
+        return true;
+    }
+
+    // Map the compiled bank, but only if it was built from the current questions.txt
+    bool loadCompiled(const std::string &textPath, const std::string &compiledPath) {
+        return loadCompiled(compiledPath, snapshotBank(textPath));
+    }
+
+    // Map the compiled bank, but only if it was built from questions.txt as it was at 'source'
+    bool loadCompiled(const std::string &compiledPath, const FileInfo &source) {
+        if (source.exists && mapped.open(compiledPath) && validImage(mapped.data(), mapped.size())) {
+            const BankHeader *h = reinterpret_cast<const BankHeader *>(mapped.data());
+            if (h->sourceSize == source.size && h->sourceMtime == source.mtime) {
+                useImage(mapped.data(), mapped.size());
+                compiled = true;
+                return true;
+            }
+        }
+        mapped.close();
+        return false;
+    }
+
+    // Load the compiled bank if it matches questions.txt, otherwise parse the
+    // text on 'threads' cores (0 = all)
+    bool load(const std::string &textPath, const std::string &compiledPath, size_t threads = 0) {
+        return load(textPath, compiledPath, snapshotBank(textPath), threads);
+    }
+
+    // The same for questions.txt as it was at 'source': the bank holds exactly
+    // the records before source.size, even if more were appended since
+    bool load(const std::string &textPath, const std::string &compiledPath, const FileInfo &source,
+              size_t threads = 0) {
+        if (loadCompiled(compiledPath, source)) return true;
+
+        std::vector<char> image;
+        if (!source.exists || !parseTextImage(textPath, source, image, nullptr, threads)) return false;
+        mapped.close();
+        owned.swap(image);
+        useImage(owned.data(), owned.size());
+        compiled = false;
+        return true;
+    }
+
+    // Use questions collected in memory, built from questions.txt as it was at 'source'
+    void adopt(const BankBuilder &builder, const FileInfo &source) {
+        mapped.close();
+        owned = builder.image(source);
+        useImage(owned.data(), owned.size());
+        compiled = false;
+    }
+
+    bool isCompiled() const { return compiled; }
+
+    // Add every question to 'builder' as they are, without going through the texts
+    void copyTo(BankBuilder &builder) const {
+        if (!base) return;
+        const BankHeader &h = header();
+        builder.addLaidOut(reinterpret_cast<const BankEntry *>(base + h.entriesOffset), h.count,
+                           base + h.poolOffset, (size_t)h.poolSize);
+    }
+
+    size_t size() const { return base ? header().count : 0; }
+
+    QuestionRecord question(size_t index) const {
+        QuestionRecord q;
+        if (index >= size()) return q;
+
+        const BankHeader &h = header();
+        const BankEntry &e = entries()[index];
+        const char *pool = base + h.poolOffset;
+        uint64_t offset = e.textOffset;
+        uint64_t end = offset + e.textLength;
+        for (int i = 0; i < e.numOptions && i < MAX_OPTIONS; ++i) end += e.optionLength[i];
+        if (end > h.poolSize) return q;  // Corrupt entry, report an empty question
+
+        q.id = e.id ? e.id : (uint32_t)(index + 1);
+        q.type = e.type;
+        q.correctAnswer = e.correctAnswer;
+        q.numOptions = e.numOptions;
+        q.text = std::string_view(pool + offset, e.textLength);
+        offset += e.textLength;
+        for (int i = 0; i < q.numOptions; ++i) {
+            q.options[i] = std::string_view(pool + offset, e.optionLength[i]);
+            offset += e.optionLength[i];
+        }
+        return q;
+    }
+
+    // Position in the bank of the question with ID 'id'. When an ID is used
+    // more than once (only possible by editing questions.txt by hand), the
+    // first question with it wins.
+    bool ordinalOf(uint32_t id, size_t &ordinal) const {
+        if (id == 0) return false;
+        if (!lookupBuilt.load(std::memory_order_acquire)) buildLookup();
+        uint32_t found = 0;
+        if (!byId.empty() || bySparseId.empty()) {
+            found = id < byId.size() ? byId[id] : 0;
+        } else {
+            auto it = bySparseId.find(id);
+            found = it != bySparseId.end() ? it->second : 0;
+        }
+        if (found == 0) return false;
+        ordinal = found - 1;
+        return true;
+    }
+
+    bool find(uint32_t id, QuestionRecord &q) const {
+        size_t ordinal;
+        if (!ordinalOf(id, ordinal)) return false;
+        q = question(ordinal);
+        return true;
+    }
+
+    // Highest ID in the bank; questions added later all get higher ones
+    uint32_t highestId() const {
+        if (!lookupBuilt.load(std::memory_order_acquire)) buildLookup();
+        return highest;
+    }
+
+    // Questions whose ID an earlier question already has
+    size_t duplicateIds() const {
+        if (!lookupBuilt.load(std::memory_order_acquire)) buildLookup();
+        return duplicates;
+    }
+};
+
+// --- Offset index over questions.txt ---
+//
+// questions.idx holds the byte offset of every record in questions.txt, so a
+// single question can be parsed straight from its offset instead of scanning
+// the file, and the next free question ID, so adding a question does not
+// have to scan for it. Adding a question appends its offset to the index,
+// and an index that no longer matches the text size is rebuilt.
+
+const char INDEX_MAGIC[8] = {'Q', 'U', 'I', 'Z', 'I', 'D', 'X', '\0'};
+const uint32_t INDEX_VERSION = 2;  // 2: the header holds the next free ID
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nextId;      // Above every ID in the file, explicit or by position
+    uint64_t count;
+    uint64_t sourceSize;  // Size of questions.txt covered by the index
+};
+
+static_assert(sizeof(IndexHeader) == 32, "IndexHeader layout changed");
+
+class QuestionIndex {
+private:
+    MappedFile mapped;
+    MappedFile text;
+    std::vector<uint64_t> built;  // Offsets when the index file could not be used
+    const uint64_t *offsets = nullptr;
+    size_t count = 0;
+
+    static bool readHeader(std::fstream &file, IndexHeader &h) {
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char *>(&h), sizeof(h))) return false;
+        return memcmp(h.magic, INDEX_MAGIC, sizeof(h.magic)) == 0 && h.version == INDEX_VERSION;
+    }
+
+    // Scan the 'size' bytes of questions.txt at 'data' and write questions.idx
+    static void buildOver(const char *data, uint64_t size, const std::string &indexPath, std::vector<uint64_t> &out,
+                          uint32_t *nextId) {
+        out.clear();
+        QuestionTextParser parser(data, (size_t)size);
+        QuestionRecord q;
+        uint64_t start;
+        uint32_t highest = 0;
+        while (parser.next(q, &start)) {
+            highest = std::max(highest, q.id ? q.id : (uint32_t)(out.size() + 1));
+            out.push_back(start);
+        }
+
+        IndexHeader h = {};
+        memcpy(h.magic, INDEX_MAGIC, sizeof(h.magic));
+        h.version = INDEX_VERSION;
+        h.nextId = highest + 1;
+        h.count = out.size();
+        h.sourceSize = size;
+        if (nextId) *nextId = h.nextId;
+
+        std::string tmpPath = tempPathFor(indexPath);
+        {
+            std::ofstream idx(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!idx.is_open()) return;  // Still usable from memory this time
+            idx.write(reinterpret_cast<const char *>(&h), sizeof(h));
+            idx.write(reinterpret_cast<const char *>(out.data()), (std::streamsize)(out.size() * sizeof(uint64_t)));
+        }
+        replaceFile(tmpPath, indexPath);
+    }
+public:
+    // Scan the first 'size' bytes of questions.txt and write questions.idx,
+    // for a caller that holds the lock on questions.txt or took a snapshot
+    static bool buildFrom(const std::string &textPath, const std::string &indexPath, uint64_t size,
+                          std::vector<uint64_t> &out, uint32_t *nextId = nullptr) {
+        MappedFile file;
+        if (!file.open(textPath) && !(getFileInfo(textPath).exists && size == 0)) return false;
+        buildOver(file.data(), std::min<uint64_t>(size, file.size()), indexPath, out, nextId);
+        return true;
+    }
+
+    // Scan questions.txt once and write questions.idx
+    static bool build(const std::string &textPath, const std::string &indexPath, std::vector<uint64_t> &out) {
+        FileInfo source = snapshotBank(textPath);
+        return buildFrom(textPath, indexPath, source.size, out);
+    }
+
+    // The next free question ID of a questions.txt that is 'size' bytes long,
+    // with the exclusive lock on it held. Rebuilds an index that is out of date.
+    static bool nextFreeId(const std::string &textPath, const std::string &indexPath, uint64_t size, uint32_t &id) {
+        {
+            std::fstream idx(indexPath, std::ios::in | std::ios::binary);
+            IndexHeader h;
+            if (idx.is_open() && readHeader(idx, h) && h.sourceSize == size) {
+                id = h.nextId;
+                return true;
+            }
+        }
+        std::vector<uint64_t> offsets;
+        return buildFrom(textPath, indexPath, size, offsets, &id);
+    }
+
+    // Record questions just appended at 'offsets' to a questions.txt that was
+    // 'before' bytes long, taking IDs up to 'nextId', with the exclusive lock
+    // on questions.txt held. Only applies when the index covered the whole
+    // file before the append; otherwise it is rebuilt on next open.
+    static void recordAppend(const std::string &textPath, const std::string &indexPath, uint64_t before,
+                             const std::vector<uint64_t> &offsets, uint32_t nextId) {
+        std::fstream idx(indexPath, std::ios::in | std::ios::out | std::ios::binary);
+        IndexHeader h;
+        if (!idx.is_open() || !readHeader(idx, h) || h.sourceSize != before) return;
+
+        idx.seekp((std::streamoff)(sizeof(IndexHeader) + h.count * sizeof(uint64_t)));
+        idx.write(reinterpret_cast<const char *>(offsets.data()), (std::streamsize)(offsets.size() * sizeof(uint64_t)));
+        h.count += offsets.size();
+        h.sourceSize = getFileInfo(textPath).size;
+        h.nextId = std::max(h.nextId, nextId);
+        idx.seekp(0);
+        idx.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    }
+
+    bool open(const std::string &textPath, const std::string &indexPath) {
+        FileInfo source = snapshotBank(textPath);
+        // Mapped after the snapshot, so every record the snapshot covers is in the mapping
+        if (!text.open(textPath) && !(source.exists && source.size == 0)) return false;
+
+        if (mapped.open(indexPath) && mapped.size() >= sizeof(IndexHeader)) {
+            const IndexHeader *h = reinterpret_cast<const IndexHeader *>(mapped.data());
+            if (memcmp(h->magic, INDEX_MAGIC, sizeof(h->magic)) == 0 && h->version == INDEX_VERSION &&
+                h->sourceSize == source.size && h->count <= (mapped.size() - sizeof(IndexHeader)) / sizeof(uint64_t)) {
+                offsets = reinterpret_cast<const uint64_t *>(mapped.data() + sizeof(IndexHeader));
+                count = (size_t)h->count;
+                return true;
+            }
+        }
+        mapped.close();
+
+        // From the mapping already taken, so no offset can point past its end
+        buildOver(text.data(), std::min<uint64_t>(source.size, text.size()), indexPath, built, nullptr);
+        offsets = built.data();
+        count = built.size();
+        return true;
+    }
+
+    size_t size() const { return count; }
+
+    // Parse question number 'ordinal' (0-based) straight from its offset.
+    // The record points into the mapped questions.txt, valid while the index is open.
+    bool fetch(size_t ordinal, QuestionRecord &q) {
+        if (ordinal >= count) return false;
+        QuestionTextParser parser(text.data(), text.size(), (size_t)offsets[ordinal]);
+        if (!parser.next(q)) return false;
+        if (q.id == 0) q.id = (uint32_t)(ordinal + 1);
+        return true;
+    }
+};
+
+// Append whole records ("MCQ\n...", as formatQuestionRecord writes them) to
+// questions.txt in a single write and add them to questions.idx, holding the
+// exclusive lock for just that long. Each record is given the next free ID,
+// written on its tag line; the first one goes to 'firstId'. 'starts' holds
+// the offset of every record within 'records', the first of them 0.
+inline bool appendQuestionRecords(const std::string &textPath, const std::string &indexPath, const std::string &records,
+                                  const std::vector<uint64_t> &starts, uint32_t *firstId = nullptr) {
+    FileLock lock;
+    lock.open(textPath);
+    FileLockGuard guard(lock, true);
+
+    RawFile file;
+    if (!file.open(textPath)) return false;
+    uint64_t before = file.size(), offset = before;
+    uint32_t nextId;
+    if (!QuestionIndex::nextFreeId(textPath, indexPath, before, nextId)) return false;
+    if (firstId) *firstId = nextId;
+
+    std::string stamped;
+    std::vector<uint64_t> stampedStarts(starts.size());
+    stamped.reserve(records.size() + starts.size() * 11);
+    for (size_t i = 0; i < starts.size(); ++i) {
+        size_t from = (size_t)starts[i], to = i + 1 < starts.size() ? (size_t)starts[i + 1] : records.size();
+        size_t tagEnd = std::min(records.find('\n', from), to);
+        stampedStarts[i] = stamped.size();
+        stamped.append(records, from, tagEnd - from);
+        stamped += ' ';
+        stamped += std::to_string(nextId++);
+        stamped.append(records, tagEnd, to - tagEnd);
+    }
+
+    char last = '\n';
+    if (before > 0 && file.readAt(before - 1, &last, 1) && last != '\n') {
+        // A file edited by hand may lack the final newline, which would join the first tag to its last line
+        if (!file.writeAt(offset, "\n", 1)) return false;
+        offset++;
+    }
+    if (!file.writeAt(offset, stamped.data(), stamped.size())) {
+        file.truncate(before);  // Never leave half a record for readers to trip over
+        return false;
+    }
+    file.close();
+    std::vector<uint64_t> offsets(starts.size());
+    for (size_t i = 0; i < starts.size(); ++i) offsets[i] = offset + stampedStarts[i];
+    QuestionIndex::recordAppend(textPath, indexPath, before, offsets, nextId);
+    return true;
+}
+
+inline bool appendQuestionRecord(const std::string &textPath, const std::string &indexPath, const std::string &record,
+                                 uint32_t *id = nullptr) {
+    return appendQuestionRecords(textPath, indexPath, record, {0}, id);
+}
+
+// Write its ID onto the tag line of every record that has none, so records
+// can then be removed or reordered by hand without any question's ID
+// changing. questions.txt is rewritten to a temp file and renamed over,
+// under the exclusive lock; 'assigned' receives the number of records changed.
+inline bool assignQuestionIds(const std::string &textPath, const std::string &indexPath, size_t &assigned) {
+    assigned = 0;
+    FileLock lock;
+    lock.open(textPath);
+    FileLockGuard guard(lock, true);
+
+    MappedFile file;
+    if (!file.open(textPath)) {
+        FileInfo info = getFileInfo(textPath);
+        return info.exists && info.size == 0;
+    }
+    const char *data = file.data();
+    size_t size = file.size();
+    std::string out;
+    out.reserve(size + size / 16);
+    QuestionTextParser parser(data, size);
+    QuestionRecord q;
+    uint64_t start;
+    size_t copied = 0, ordinal = 0;
+    while (parser.next(q, &start)) {
+        ordinal++;
+        if (q.id != 0) continue;
+        // Replace the tag line, keeping its line ending
+        const char *nl = (const char *)memchr(data + start, '\n', size - (size_t)start);
+        size_t lineEnd = nl ? (size_t)(nl - data) : size;
+        if (lineEnd > start && data[lineEnd - 1] == '\r') lineEnd--;
+        out.append(data + copied, (size_t)start - copied);
+        out += q.type == QUESTION_TF ? "TF " : "MCQ ";
+        out += std::to_string(ordinal);
+        copied = lineEnd;
+        assigned++;
+    }
+    if (assigned == 0) return true;
+    out.append(data + copied, size - copied);
+    file.close();
+
+    std::string tmpPath = tempPathFor(textPath);
+    {
+        std::ofstream tmp(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!tmp.is_open()) return false;
+        tmp.write(out.data(), (std::streamsize)out.size());
+        if (!tmp) {
+            tmp.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (!replaceFile(tmpPath, textPath)) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    std::vector<uint64_t> offsets;
+    QuestionIndex::buildFrom(textPath, indexPath, out.size(), offsets);
+    return true;
+}
+
+// Pick k distinct ordinals out of n uniformly at random (Floyd's algorithm),
+// returned in random order. Costs O(k) no matter how large the bank is.
+template <class Rng>
+std::vector<size_t> sampleQuestionOrdinals(size_t n, size_t k, Rng &rng) {
+    if (k > n) k = n;
+    std::vector<size_t> picked;
+    std::unordered_set<size_t> seen;
+    picked.reserve(k);
+    for (size_t j = n - k; j < n; ++j) {
+        size_t t = std::uniform_int_distribution<size_t>(0, j)(rng);
+        if (seen.insert(t).second) {
+            picked.push_back(t);
+        } else {
+            seen.insert(j);
+            picked.push_back(j);
+        }
+    }
+    std::shuffle(picked.begin(), picked.end(), rng);
+    return picked;
+}
+
+#endif
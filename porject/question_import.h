@@ -0,0 +1,522 @@
+#ifndef QUESTION_IMPORT_H
+#define QUESTION_IMPORT_H
+
+// Bulk import of questions from CSV or JSON Lines files.
+//
+// Both formats hold one question per line. CSV rows are
+//
+//     type,question,answer,option1,option2,...
+//
+// with type MCQ or TF, fields quoted with '"' when they hold a comma or a
+// quote (a quote inside is doubled), and an optional header row starting
+// with "type". JSON Lines rows are objects such as
+//
+//     {"type": "MCQ", "question": "2 + 2?", "options": ["3", "4", "5", "6"], "answer": 2}
+//
+// where other keys are ignored. An MCQ needs exactly MAX_OPTIONS options and
+// an answer between 1 and MAX_OPTIONS; a TF question has no options and an
+// answer of 1 (true) or 2 (false). Fields cannot hold line breaks, as
+// questions.txt keeps each text on one line.
+//
+// The file is mapped and split into chunks at line boundaries, and every
+// core validates one chunk, writing its good rows out as questions.txt
+// records with a content hash of each. The records are then checked in file
+// order against each other and the current bank: a record identical to one
+// already seen is dropped as a duplicate. Everything left is appended to
+// questions.txt in one locked write.
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "platform.h"
+#include "question_bank.h"
+#include "question_kinds.h"
+
+enum ImportFormat { IMPORT_CSV, IMPORT_JSONL };
+
+struct ImportError {
+    size_t line;  // 1-based line of the import file
+    std::string message;
+};
+
+struct ImportReport {
+    size_t rows = 0;        // Rows holding a question, valid or not
+    size_t imported = 0;
+    size_t duplicates = 0;  // Valid rows dropped as a copy of an earlier one or of the bank
+    uint32_t firstId = 0;   // ID given to the first imported question; the rest follow on
+    std::vector<ImportError> errors;
+};
+
+// 64-bit FNV-1a
+inline uint64_t importContentHash(std::string_view s) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+inline bool importNameIs(std::string_view s, const char *name) {
+    size_t n = strlen(name);
+    if (s.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        char c = s[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        if (c != name[i]) return false;
+    }
+    return true;
+}
+
+// Check one question's fields and fill in q, whose views point into them.
+// Returns an empty string, or what is wrong.
+inline std::string validateImport(std::string_view type, const std::string &text, const std::vector<std::string> &options,
+                                  std::string_view answer, QuestionRecord &q) {
+    q = QuestionRecord();
+    type = trimBankField(type);
+    if (importNameIs(type, "mcq")) {
+        q.type = QUESTION_MCQ;
+    } else if (importNameIs(type, "tf")) {
+        q.type = QUESTION_TF;
+    } else {
+        return "type must be MCQ or TF";
+    }
+    if (trimBankField(text).empty()) return "question text is empty";
+    if (text.find_first_of("\r\n") != std::string::npos) return "question text holds a line break";
+
+    if (q.type == QUESTION_MCQ && options.size() != (size_t)MAX_OPTIONS) {
+        return "an MCQ needs exactly " + std::to_string(MAX_OPTIONS) + " options, not " + std::to_string(options.size());
+    }
+    if (q.type == QUESTION_TF && !options.empty()) return "a TF question takes no options";
+    for (const std::string &o : options) {
+        if (o.find_first_of("\r\n") != std::string::npos) return "an option holds a line break";
+    }
+
+    if (!parseBankAnswer(answer, q.correctAnswer)) return "answer is not a whole number";
+    q.numOptions = (int)options.size();
+    if (!validQuestionAnswer(q, q.correctAnswer)) {
+        return q.type == QUESTION_TF ? "a TF answer must be 1 (true) or 2 (false)"
+                                     : "answer must be between 1 and " + std::to_string(MAX_OPTIONS);
+    }
+
+    q.text = text;
+    for (size_t i = 0; i < options.size(); ++i) q.options[i] = options[i];
+    return "";
+}
+
+// --- CSV ---
+
+// Split one CSV line into fields. Returns an empty string, or what is wrong.
+inline std::string splitCsvLine(std::string_view line, std::vector<std::string> &fields) {
+    fields.clear();
+    size_t i = 0;
+    while (true) {
+        std::string field;
+        if (i < line.size() && line[i] == '"') {
+            ++i;
+            while (true) {
+                if (i >= line.size()) return "quoted field is not closed on its line";
+                char c = line[i++];
+                if (c != '"') {
+                    field += c;
+                } else if (i < line.size() && line[i] == '"') {
+                    field += '"';
+                    ++i;
+                } else {
+                    break;
+                }
+            }
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+            if (i < line.size() && line[i] != ',') return "text after a closing quote";
+        } else {
+            size_t comma = line.find(',', i);
+            size_t stop = comma == std::string_view::npos ? line.size() : comma;
+            field.assign(line.substr(i, stop - i));
+            i = stop;
+        }
+        fields.push_back(std::move(field));
+        if (i >= line.size()) return "";
+        ++i;  // Skip the ','
+    }
+}
+
+// --- JSON Lines ---
+
+// Just enough JSON for one flat object per line
+class JsonLineReader {
+private:
+    std::string_view s;
+    size_t pos = 0;
+    int depth = 0;
+
+    static void appendUtf8(std::string &out, uint32_t c) {
+        if (c < 0x80) {
+            out += (char)c;
+        } else if (c < 0x800) {
+            out += (char)(0xC0 | (c >> 6));
+            out += (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += (char)(0xE0 | (c >> 12));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        } else {
+            out += (char)(0xF0 | (c >> 18));
+            out += (char)(0x80 | ((c >> 12) & 0x3F));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+    }
+
+    bool hex4(uint32_t &c) {
+        if (pos + 4 > s.size()) return false;
+        std::from_chars_result r = std::from_chars(s.data() + pos, s.data() + pos + 4, c, 16);
+        if (r.ptr != s.data() + pos + 4) return false;
+        pos += 4;
+        return true;
+    }
+public:
+    explicit JsonLineReader(std::string_view line) : s(line) {}
+
+    void skipSpace() {
+        while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\r')) ++pos;
+    }
+
+    bool atEnd() {
+        skipSpace();
+        return pos >= s.size();
+    }
+
+    // Consume 'c' if it comes next
+    bool take(char c) {
+        skipSpace();
+        if (pos < s.size() && s[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char c) {
+        skipSpace();
+        return pos < s.size() && s[pos] == c;
+    }
+
+    bool readString(std::string &out) {
+        out.clear();
+        if (!take('"')) return false;
+        while (pos < s.size()) {
+            char c = s[pos++];
+            if (c == '"') return true;
+            if ((unsigned char)c < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= s.size()) return false;
+            char e = s[pos++];
+            switch (e) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t c1 = 0;
+                if (!hex4(c1)) return false;
+                if (c1 >= 0xD800 && c1 < 0xDC00) {
+                    uint32_t c2 = 0;
+                    if (pos + 2 > s.size() || s[pos] != '\\' || s[pos + 1] != 'u') return false;
+                    pos += 2;
+                    if (!hex4(c2) || c2 < 0xDC00 || c2 >= 0xE000) return false;
+                    c1 = 0x10000 + ((c1 - 0xD800) << 10) + (c2 - 0xDC00);
+                } else if (c1 >= 0xDC00 && c1 < 0xE000) {
+                    return false;
+                }
+                appendUtf8(out, c1);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // A number token, as written
+    bool readNumber(std::string_view &out) {
+        skipSpace();
+        size_t start = pos;
+        while (pos < s.size() && s[pos] != '\0' && strchr("+-0123456789.eE", s[pos])) ++pos;
+        out = s.substr(start, pos - start);
+        return pos > start;
+    }
+
+    // Skip a value of any type
+    bool skipValue() {
+        skipSpace();
+        if (pos >= s.size()) return false;
+        char c = s[pos];
+        std::string scratch;
+        std::string_view token;
+        if (c == '"') return readString(scratch);
+        if (c == '{' || c == '[') {
+            if (++depth > 64) return false;
+            char close = c == '{' ? '}' : ']';
+            ++pos;
+            if (!take(close)) {
+                do {
+                    if (c == '{' && !(readString(scratch) && take(':'))) return false;
+                    if (!skipValue()) return false;
+                } while (take(','));
+                if (!take(close)) return false;
+            }
+            --depth;
+            return true;
+        }
+        for (const char *word : {"true", "false", "null"}) {
+            if (s.substr(pos, strlen(word)) == word) {
+                pos += strlen(word);
+                return true;
+            }
+        }
+        return readNumber(token);
+    }
+};
+
+// Pull the question's fields out of one JSON object
+inline std::string parseJsonQuestion(std::string_view line, std::string &type, std::string &text,
+                                     std::vector<std::string> &options, std::string &answer) {
+    type.clear();
+    text.clear();
+    options.clear();
+    answer.clear();
+    bool haveType = false, haveText = false, haveAnswer = false;
+    JsonLineReader json(line);
+    if (!json.take('{')) return "row is not a JSON object";
+    std::string key, value;
+    if (!json.take('}')) {
+        do {
+            if (!json.readString(key) || !json.take(':')) return "malformed JSON";
+            if (key == "type" || key == "question" || key == "text") {
+                if (!json.readString(value)) return "\"" + key + "\" must be a string";
+                if (key == "type") {
+                    type = value;
+                    haveType = true;
+                } else {
+                    text = value;
+                    haveText = true;
+                }
+            } else if (key == "options") {
+                if (!json.take('[')) return "\"options\" must be an array of strings";
+                if (!json.take(']')) {
+                    do {
+                        if (!json.readString(value)) return "\"options\" must be an array of strings";
+                        options.push_back(value);
+                    } while (json.take(','));
+                    if (!json.take(']')) return "malformed JSON";
+                }
+            } else if (key == "answer") {
+                std::string_view number;
+                if (json.peek('"')) {
+                    if (!json.readString(answer)) return "malformed JSON";
+                } else if (json.readNumber(number)) {
+                    answer.assign(number);
+                } else {
+                    return "\"answer\" must be a number";
+                }
+                haveAnswer = true;
+            } else if (!json.skipValue()) {
+                return "malformed JSON";
+            }
+        } while (json.take(','));
+        if (!json.take('}')) return "malformed JSON";
+    }
+    if (!json.atEnd()) return "text after the JSON object";
+    if (!haveType) return "\"type\" is missing";
+    if (!haveText) return "\"question\" is missing";
+    if (!haveAnswer) return "\"answer\" is missing";
+    return "";
+}
+
+// --- Parallel validation ---
+
+struct ImportedRecord {
+    size_t start;   // Within the chunk's text
+    size_t length;
+    uint64_t hash;
+    size_t line;    // Within the chunk, 1-based
+};
+
+struct ImportChunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    bool first = false;  // Holds the start of the file, where a CSV header may be
+    size_t lines = 0;
+    size_t rows = 0;
+    std::string text;    // Valid rows as questions.txt records
+    std::vector<ImportedRecord> records;
+    std::vector<ImportError> errors;  // Lines within the chunk
+};
+
+inline void importChunk(ImportChunk &c, ImportFormat format) {
+    std::vector<std::string> fields, options;
+    std::string type, text, answer;
+    QuestionRecord q;
+    bool headerChecked = !c.first || format != IMPORT_CSV;
+    const char *p = c.begin;
+    while (p < c.end) {
+        const char *newline = (const char *)memchr(p, '\n', (size_t)(c.end - p));
+        const char *stop = newline ? newline : c.end;
+        std::string_view line(p, (size_t)(stop - p));
+        p = newline ? newline + 1 : c.end;
+        c.lines++;
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        if (trimBankField(line).empty()) continue;
+
+        std::string error;
+        if (format == IMPORT_CSV) {
+            error = splitCsvLine(line, fields);
+            if (!headerChecked) {
+                headerChecked = true;
+                if (!fields.empty() && importNameIs(trimBankField(fields[0]), "type")) continue;
+            }
+            c.rows++;
+            if (error.empty() && fields.size() < 3) error = "a row needs at least type, question and answer";
+            if (error.empty()) {
+                options.assign(fields.begin() + 3, fields.end());
+                error = validateImport(fields[0], fields[1], options, fields[2], q);
+            }
+        } else {
+            c.rows++;
+            error = parseJsonQuestion(line, type, text, options, answer);
+            if (error.empty()) error = validateImport(type, text, options, answer, q);
+        }
+        if (!error.empty()) {
+            c.errors.push_back(ImportError{c.lines, error});
+            continue;
+        }
+
+        size_t start = c.text.size();
+        formatQuestionRecord(c.text, q);
+        std::string_view record(c.text.data() + start, c.text.size() - start);
+        c.records.push_back(ImportedRecord{start, record.size(), importContentHash(record), c.lines});
+    }
+}
+
+// JSON Lines for .jsonl, .ndjson and .json files, and for anything starting
+// with '{'; CSV otherwise
+inline ImportFormat detectImportFormat(const std::string &path, const char *data, size_t size) {
+    size_t dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+    if (importNameIs(ext, "jsonl") || importNameIs(ext, "ndjson") || importNameIs(ext, "json")) return IMPORT_JSONL;
+    if (importNameIs(ext, "csv")) return IMPORT_CSV;
+    size_t i = 0;
+    while (i < size && (data[i] == ' ' || data[i] == '\t' || data[i] == '\r' || data[i] == '\n')) ++i;
+    return i < size && data[i] == '{' ? IMPORT_JSONL : IMPORT_CSV;
+}
+
+// Import every valid, new question in importPath into questions.txt, on
+// 'threads' cores (0 = all). 'existing' is the bank to check for duplicates;
+// it may be null. Returns false if a file could not be read or written.
+inline bool importQuestions(const std::string &importPath, const std::string &textPath, const std::string &indexPath,
+                            const QuestionBank *existing, ImportReport &report, size_t threads = 0) {
+    report = ImportReport();
+    MappedFile input;
+    if (!input.open(importPath)) {
+        FileInfo info = getFileInfo(importPath);
+        return info.exists && info.size == 0;  // An empty file has nothing to import
+    }
+    const char *begin = input.data();
+    const char *end = begin + input.size();
+    if (input.size() >= 3 && memcmp(begin, "\xEF\xBB\xBF", 3) == 0) begin += 3;  // UTF-8 byte order mark
+    size_t size = (size_t)(end - begin);
+    ImportFormat format = detectImportFormat(importPath, begin, size);
+
+    // Split at line boundaries, at least 1 MB per chunk
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, size / (1 << 20) + 1));
+    std::vector<ImportChunk> chunks(threads);
+    const char *cut = begin;
+    for (size_t t = 0; t < threads; ++t) {
+        chunks[t].begin = cut;
+        chunks[t].first = t == 0;
+        if (t + 1 < threads) {
+            const char *target = std::max(cut, begin + size * (t + 1) / threads);
+            const char *nl = (const char *)memchr(target, '\n', (size_t)(end - target));
+            cut = nl ? nl + 1 : end;
+        } else {
+            cut = end;
+        }
+        chunks[t].end = cut;
+    }
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; ++t) pool.emplace_back(importChunk, std::ref(chunks[t]), format);
+    importChunk(chunks[0], format);
+    for (std::thread &t : pool) t.join();
+
+    // Drop duplicates in file order. Values below bankSize are ordinals in
+    // the bank, the rest index 'kept'.
+    size_t bankSize = existing ? existing->size() : 0;
+    size_t total = 0;
+    for (const ImportChunk &c : chunks) total += c.records.size();
+    std::unordered_multimap<uint64_t, size_t> seen;
+    seen.reserve(bankSize + total);
+    std::string scratch;
+    for (size_t i = 0; i < bankSize; ++i) {
+        scratch.clear();
+        formatQuestionRecord(scratch, existing->question(i));
+        seen.emplace(importContentHash(scratch), i);
+    }
+
+    std::vector<std::string_view> kept;
+    std::string out;
+    std::vector<uint64_t> starts;
+    size_t textBytes = 0;
+    for (const ImportChunk &c : chunks) textBytes += c.text.size();
+    out.reserve(textBytes);
+    starts.reserve(total);
+    size_t lineBase = 0;
+    for (const ImportChunk &c : chunks) {
+        report.rows += c.rows;
+        for (const ImportError &e : c.errors) report.errors.push_back(ImportError{lineBase + e.line, e.message});
+        for (const ImportedRecord &r : c.records) {
+            std::string_view record(c.text.data() + r.start, r.length);
+            bool duplicate = false;
+            auto range = seen.equal_range(r.hash);
+            for (auto it = range.first; it != range.second && !duplicate; ++it) {
+                if (it->second < bankSize) {
+                    scratch.clear();
+                    formatQuestionRecord(scratch, existing->question(it->second));
+                    duplicate = scratch == record;
+                } else {
+                    duplicate = kept[it->second - bankSize] == record;
+                }
+            }
+            if (duplicate) {
+                report.duplicates++;
+                continue;
+            }
+            seen.emplace(r.hash, bankSize + kept.size());
+            kept.push_back(record);
+            starts.push_back(out.size());
+            out += record;
+        }
+        lineBase += c.lines;
+    }
+
+    if (!kept.empty() && !appendQuestionRecords(textPath, indexPath, out, starts, &report.firstId)) return false;
+    report.imported = kept.size();
+    return true;
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef QUESTION_KINDS_H
+#define QUESTION_KINDS_H
+
+// Question shapes fixed at compile time.
+//
+// Nearly every question is a true/false question or an MCQ with MAX_OPTIONS
+// options, the only two shapes questions.txt can hold. Each shape is a type,
+// QuestionShape<kind, options>, whose number of choices is a constant, so
+// showing a question is a fixed run of appends with the option labels baked
+// in, and checking an answer is a compare against constant bounds.
+// withQuestionShape() looks at a record once and calls a generic function
+// with its shape. A question of any other shape, such as an MCQ given fewer
+// options in code, gets RuntimeShape, which does the same with the count
+// taken from the record.
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "question_bank.h"
+
+static_assert(MAX_OPTIONS >= 2 && MAX_OPTIONS <= 9, "option labels are single digits");
+
+template <int Kind, int Choices>
+struct QuestionShape {
+    static_assert(Kind == QUESTION_MCQ || Kind == QUESTION_TF, "unknown question kind");
+    static_assert(Choices >= 2 && Choices <= MAX_OPTIONS, "number of choices out of range");
+    static_assert(Kind != QUESTION_TF || Choices == 2, "a TF question has two choices");
+
+    static constexpr int kind = Kind;
+    static constexpr int choices() { return Choices; }
+    static constexpr bool validAnswer(int answer) { return answer >= 1 && answer <= Choices; }
+
+    // The numbered choice lines of q ("1. ...\n")
+    static void renderChoices(std::string &out, const QuestionRecord &q) {
+        if constexpr (Kind == QUESTION_TF) {
+            out.append("1. True\n2. False\n", 17);
+        } else {
+            renderOptions(out, q, std::make_integer_sequence<int, Choices>());
+        }
+    }
+private:
+    template <int... I>
+    static void renderOptions(std::string &out, const QuestionRecord &q, std::integer_sequence<int, I...>) {
+        (renderOption<I>(out, q.options[I]), ...);
+    }
+
+    template <int I>
+    static void renderOption(std::string &out, std::string_view option) {
+        static constexpr char label[3] = {(char)('1' + I), '.', ' '};
+        out.append(label, sizeof(label));
+        out.append(option.data(), option.size());
+        out += '\n';
+    }
+};
+
+using TrueFalseShape = QuestionShape<QUESTION_TF, 2>;
+using FullChoiceShape = QuestionShape<QUESTION_MCQ, MAX_OPTIONS>;
+
+static_assert(TrueFalseShape::validAnswer(2) && !TrueFalseShape::validAnswer(3), "TF answers are 1 or 2");
+static_assert(FullChoiceShape::validAnswer(MAX_OPTIONS) && !FullChoiceShape::validAnswer(0), "MCQ answer range");
+
+// An MCQ whose number of options is only known from the record
+struct RuntimeShape {
+    int count;
+
+    static constexpr int kind = QUESTION_MCQ;
+    constexpr int choices() const { return count; }
+    constexpr bool validAnswer(int answer) const { return answer >= 1 && answer <= count; }
+
+    void renderChoices(std::string &out, const QuestionRecord &q) const {
+        char label[3] = {'1', '.', ' '};
+        for (int i = 0; i < count; ++i, ++label[0]) {
+            out.append(label, sizeof(label));
+            out.append(q.options[i].data(), q.options[i].size());
+            out += '\n';
+        }
+    }
+};
+
+// Call f with the shape of q
+template <class F>
+inline decltype(auto) withQuestionShape(const QuestionRecord &q, F &&f) {
+    if (q.type == QUESTION_TF) return f(TrueFalseShape());
+    if (q.numOptions == MAX_OPTIONS) return f(FullChoiceShape());
+    return f(RuntimeShape{std::max(0, std::min(q.numOptions, MAX_OPTIONS))});
+}
+
+// Number of choices an answer to q picks from
+inline int questionChoices(const QuestionRecord &q) {
+    return withQuestionShape(q, [](auto shape) { return shape.choices(); });
+}
+
+inline bool validQuestionAnswer(const QuestionRecord &q, int answer) {
+    return withQuestionShape(q, [answer](auto shape) { return shape.validAnswer(answer); });
+}
+
+// Whether 'choice' is the right answer to q. A choice outside the question's
+// range is wrong even when questions.txt holds that number as the answer.
+inline bool checkQuestionAnswer(const QuestionRecord &q, int choice) {
+    return withQuestionShape(q, [&](auto shape) { return shape.validAnswer(choice) && choice == q.correctAnswer; });
+}
+
+// Append q as shown to a student: its text, then its numbered choices
+inline void renderQuestion(std::string &out, const QuestionRecord &q) {
+    withQuestionShape(q, [&](auto shape) {
+        out.append(q.text.data(), q.text.size());
+        out += '\n';
+        shape.renderChoices(out, q);
+    });
+}
+
+#endif
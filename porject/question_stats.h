@@ -0,0 +1,727 @@
+#ifndef QUESTION_STATS_H
+#define QUESTION_STATS_H
+
+// Per-question attempt statistics.
+//
+// question_stats.dat is an open-addressing hash table on disk: a small header
+// followed by fixed-width slots keyed by question ID. Recording an attempt for
+// a question that already has a slot reads that slot and writes it back in
+// place, so the cost does not depend on how many questions the file holds and
+// a counter growing a digit can never spill into its neighbour.
+//
+// Several quiz processes can share the file. Updates hold an exclusive lock
+// and reads a shared one, and each re-reads the header first, so a table
+// that another process grew or compacted is picked up.
+//
+// The table only ever grows, and keeps the slots of questions that have since
+// been removed from the bank. compact() rewrites it from a sorted snapshot of
+// the entries it is told to keep (every one in the background, the questions
+// still in the bank for final --compact-stats), at no more than twice the
+// slots they need, and renames the new file over the old one. The rewrite is done without the
+// lock while updates go on; every update bumps a generation number in the
+// header, and if it moved, the counts changed since the snapshot are carried
+// over under the exclusive lock just before the rename.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "platform.h"
+#include "question_bank.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
+const char STATS_MAGIC[8] = {'Q', 'U', 'I', 'Z', 'S', 'T', 'A', '\0'};
+const uint32_t STATS_VERSION = 2;
+
+struct StatsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t generation;  // One more for every update; 0 in version 1 files
+    uint64_t capacity;  // Number of slots
+    uint64_t used;      // Slots holding a question
+};
+
+// One slot of the table; id 0 marks an empty slot
+struct QuestionStat {
+    uint32_t id;
+    uint32_t attempts;
+    uint32_t correct;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(StatsHeader) == 32, "StatsHeader layout changed");
+static_assert(sizeof(QuestionStat) == 16, "QuestionStat layout changed");
+
+// What a compaction of the store did
+struct StatsCompaction {
+    size_t kept = 0;
+    size_t dropped = 0;  // Entries of questions no longer in the bank
+    uint64_t bytesBefore = 0;
+    uint64_t bytesAfter = 0;
+    bool compacted = false;  // False if the file was already small enough
+};
+
+class QuestionStatsStore {
+private:
+    std::string path;
+    std::fstream file;
+    StatsHeader header = {};
+    FileLock lock;
+
+    static constexpr uint64_t MIN_CAPACITY = 64;
+
+    uint64_t home(uint32_t id) const {
+        return (uint64_t)(id * 2654435761u) % header.capacity;  // Knuth multiplicative hash
+    }
+
+    static std::streamoff slotOffset(uint64_t slot) {
+        return (std::streamoff)(sizeof(StatsHeader) + slot * sizeof(QuestionStat));
+    }
+
+    bool readSlot(uint64_t slot, QuestionStat &s) {
+        file.clear();
+        file.seekg(slotOffset(slot));
+        return (bool)file.read(reinterpret_cast<char *>(&s), sizeof(s));
+    }
+
+    bool writeSlot(uint64_t slot, const QuestionStat &s) {
+        file.clear();
+        file.seekp(slotOffset(slot));
+        file.write(reinterpret_cast<const char *>(&s), sizeof(s));
+        return (bool)file;
+    }
+
+    bool writeHeader() {
+        file.clear();
+        file.seekp(0);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        return (bool)file;
+    }
+
+    // Find the slot for id, or the empty slot where it would go
+    bool findSlot(uint32_t id, uint64_t &slot, QuestionStat &s) {
+        slot = home(id);
+        for (uint64_t probes = 0; probes < header.capacity; ++probes) {
+            if (!readSlot(slot, s)) return false;
+            if (s.id == id || s.id == 0) return true;
+            slot = (slot + 1) % header.capacity;
+        }
+        return false;
+    }
+
+    // Slots for a table of 'count' questions, at no more than half load
+    static uint64_t capacityFor(size_t count) {
+        return std::max<uint64_t>(MIN_CAPACITY, (uint64_t)count * 2);
+    }
+
+    // The slot holding id in an in-memory table, or the empty slot where it would go
+    static uint64_t probe(const std::vector<QuestionStat> &slots, uint32_t id) {
+        uint64_t slot = (uint64_t)(id * 2654435761u) % slots.size();
+        while (slots[slot].id != id && slots[slot].id != 0) slot = (slot + 1) % slots.size();
+        return slot;
+    }
+
+    static std::vector<QuestionStat> layout(const std::vector<QuestionStat> &stats, uint64_t capacity) {
+        std::vector<QuestionStat> slots(capacity, QuestionStat{0, 0, 0, 0});
+        for (const QuestionStat &s : stats) slots[probe(slots, s.id)] = s;
+        return slots;
+    }
+
+    static StatsHeader makeHeader(uint64_t capacity, uint64_t used, uint32_t generation) {
+        StatsHeader h = {};
+        memcpy(h.magic, STATS_MAGIC, sizeof(h.magic));
+        h.version = STATS_VERSION;
+        h.generation = generation;
+        h.capacity = capacity;
+        h.used = used;
+        return h;
+    }
+
+    static bool writeTable(const std::string &filePath, const StatsHeader &h, const std::vector<QuestionStat> &slots) {
+        std::ofstream out(filePath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char *>(slots.data()), (std::streamsize)(slots.size() * sizeof(QuestionStat)));
+        return (bool)out;
+    }
+
+    static bool createFile(const std::string &filePath, const std::vector<QuestionStat> &stats, uint64_t capacity,
+                           uint32_t generation = 0) {
+        std::string tmpPath = tempPathFor(filePath);
+        StatsHeader h = makeHeader(capacity, stats.size(), generation);
+        return writeTable(tmpPath, h, layout(stats, capacity)) && replaceFile(tmpPath, filePath);
+    }
+
+    // Carry the counts that changed between 'before' and 'after' (both sorted
+    // by ID) over into slots, noting the slots written. False if that cannot
+    // be done in place: a question was dropped meanwhile, or the table would
+    // get too full.
+    static bool patchSlots(std::vector<QuestionStat> &slots, uint64_t &used, const std::vector<QuestionStat> &before,
+                           const std::vector<QuestionStat> &after, std::vector<uint64_t> &written) {
+        size_t i = 0;
+        for (const QuestionStat &s : after) {
+            if (i < before.size() && before[i].id < s.id) return false;  // Dropped
+            bool known = i < before.size() && before[i].id == s.id;
+            if (known && before[i].attempts == s.attempts && before[i].correct == s.correct) {
+                ++i;
+                continue;
+            }
+            if (known) {
+                ++i;
+            } else if (++used * 10 > slots.size() * 7) {
+                return false;
+            }
+            uint64_t slot = probe(slots, s.id);
+            slots[slot] = s;
+            written.push_back(slot);
+        }
+        return i == before.size();
+    }
+
+    // Rewrite the table at half load once it gets too full for short probes
+    bool grow() {
+        std::vector<QuestionStat> live = readAll();
+        uint64_t capacity = capacityFor(live.size() + 1);
+        file.close();
+        if (!createFile(path, live, capacity, header.generation)) return false;
+        return openFile();
+    }
+
+    // (Re)open the file and read its header. The caller holds the lock.
+    bool openFile() {
+        file.close();
+        file.clear();
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.is_open()) return false;
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+            memcmp(header.magic, STATS_MAGIC, sizeof(header.magic)) != 0 ||
+            (header.version != STATS_VERSION && header.version != 1) || header.capacity == 0) {
+            file.close();
+            return false;
+        }
+        header.version = STATS_VERSION;  // A version 1 header is upgraded by the next write
+        return true;
+    }
+
+    // Add to a question's counters. The caller holds the exclusive lock.
+    bool addLocked(uint32_t id, uint32_t attempts, uint32_t correct) {
+        if (!file.is_open() || id == 0) return false;
+
+        uint64_t slot;
+        QuestionStat s;
+        if (!findSlot(id, slot, s)) return false;
+        if (s.id == 0) {
+            if ((header.used + 1) * 10 > header.capacity * 7) {  // Keep the load under 70%
+                if (!grow() || !findSlot(id, slot, s)) return false;
+            }
+            s = QuestionStat{id, 0, 0, 0};
+            header.used++;
+            writeHeader();
+        }
+        s.attempts += attempts;
+        s.correct += correct;
+        return writeSlot(slot, s);
+    }
+
+    std::vector<QuestionStat> readAll() {
+        std::vector<QuestionStat> out;
+        if (!file.is_open()) return out;
+        std::vector<QuestionStat> slots(header.capacity);
+        file.clear();
+        file.seekg(slotOffset(0));
+        file.read(reinterpret_cast<char *>(slots.data()), (std::streamsize)(slots.size() * sizeof(QuestionStat)));
+        for (const QuestionStat &s : slots) {
+            if (s.id != 0) out.push_back(s);
+        }
+        std::sort(out.begin(), out.end(), [](const QuestionStat &a, const QuestionStat &b) { return a.id < b.id; });
+        return out;
+    }
+public:
+    bool open(const std::string &filePath) {
+        path = filePath;
+        file.close();
+        lock.open(path);
+        FileLockGuard guard(lock, true);
+        if (!getFileInfo(path).exists && !createFile(path, {}, MIN_CAPACITY)) return false;
+        return openFile();
+    }
+
+    bool isOpen() const { return file.is_open(); }
+
+    // Add many counts in one locked update and write them through. The
+    // changes that could not be written are added to 'unwritten', if given,
+    // so they can be tried again. A store that failed to grow is reopened.
+    bool update(const std::vector<QuestionStat> &changes, std::vector<QuestionStat> *unwritten = nullptr) {
+        auto fail = [&] {
+            if (unwritten) unwritten->insert(unwritten->end(), changes.begin(), changes.end());
+            return false;
+        };
+        if (path.empty()) return fail();
+        FileLockGuard guard(lock, true);
+        if (!openFile()) return fail();  // Another process may have written or grown the table
+        bool ok = true;
+        for (const QuestionStat &c : changes) {
+            if (addLocked(c.id, c.attempts, c.correct)) continue;
+            ok = false;
+            if (unwritten && c.id != 0) unwritten->push_back(c);
+        }
+        header.generation++;  // Tells a compaction under way that counts changed
+        ok = writeHeader() && ok;
+        file.flush();
+        return ok && (bool)file;
+    }
+
+    // Add to one question's counters
+    bool add(uint32_t id, uint32_t attempts, uint32_t correct) {
+        return update({QuestionStat{id, attempts, correct, 0}});
+    }
+
+    bool record(uint32_t id, bool correct) {
+        return add(id, 1, correct ? 1 : 0);
+    }
+
+    bool get(uint32_t id, QuestionStat &s) {
+        if (!file.is_open()) return false;
+        FileLockGuard guard(lock, false);
+        uint64_t slot;
+        return openFile() && findSlot(id, slot, s) && s.id == id && id != 0;
+    }
+
+    // Every question with statistics, ordered by ID
+    std::vector<QuestionStat> all() {
+        if (!file.is_open()) return {};
+        FileLockGuard guard(lock, false);
+        if (!openFile()) return {};
+        return readAll();
+    }
+
+    // Rewrite the store at filePath with only the questions 'keep' accepts
+    // (all of them if it is empty), at no more than twice the slots they need.
+    // Unless 'force' is set, a file already within that does not get
+    // rewritten. Other threads and processes can go on updating the store
+    // meanwhile; they only wait for the last step.
+    static bool compact(const std::string &filePath, const std::function<bool(uint32_t)> &keep,
+                        StatsCompaction *report = nullptr, bool force = false) {
+        StatsCompaction r;
+        QuestionStatsStore store;
+        store.path = filePath;
+        store.lock.open(filePath);
+        auto dropUnkept = [&keep](std::vector<QuestionStat> &stats) {
+            size_t before = stats.size();
+            if (keep) {
+                stats.erase(std::remove_if(stats.begin(), stats.end(), [&](const QuestionStat &s) { return !keep(s.id); }),
+                            stats.end());
+            }
+            return before - stats.size();
+        };
+
+        // Snapshot the live entries, sorted by ID
+        std::vector<QuestionStat> snapshot;
+        uint32_t generation;
+        {
+            FileLockGuard guard(store.lock, false);
+            if (!store.openFile()) return false;
+            snapshot = store.readAll();
+            generation = store.header.generation;
+            r.bytesBefore = (uint64_t)slotOffset(store.header.capacity);
+        }
+        store.file.close();
+        r.dropped = dropUnkept(snapshot);
+        r.kept = snapshot.size();
+        uint64_t capacity = capacityFor(snapshot.size());
+        if (capacity > store.header.capacity && snapshot.size() * 10 <= store.header.capacity * 7) {
+            capacity = store.header.capacity;  // Dense enough already; never grow it
+        }
+        r.bytesAfter = (uint64_t)slotOffset(capacity);
+        if (!force && r.bytesAfter >= r.bytesBefore) {
+            r.bytesAfter = r.bytesBefore;
+            if (report) *report = r;
+            return true;
+        }
+
+        // Build the new table on the side
+        std::string tmpPath = tempPathFor(filePath + ".compact");  // Not the name grow() uses
+        std::vector<QuestionStat> slots = layout(snapshot, capacity);
+        uint64_t used = snapshot.size();
+        if (!writeTable(tmpPath, makeHeader(capacity, used, generation), slots)) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+
+        // Carry over what changed meanwhile and swap the new table in
+        FileLockGuard guard(store.lock, true);
+        bool ok = store.openFile();
+        if (ok && store.header.generation != generation) {
+            std::vector<QuestionStat> current = store.readAll();
+            r.dropped = dropUnkept(current);
+            r.kept = current.size();
+            std::vector<uint64_t> written;
+            if (patchSlots(slots, used, snapshot, current, written)) {
+                RawFile out;
+                ok = out.open(tmpPath);
+                for (size_t i = 0; ok && i < written.size(); ++i) {
+                    ok = out.writeAt((uint64_t)slotOffset(written[i]), &slots[written[i]], sizeof(QuestionStat));
+                }
+            } else {
+                // Another compaction dropped entries, or many questions were added: start over from now
+                capacity = capacityFor(current.size());
+                slots = layout(current, capacity);
+                used = current.size();
+                ok = writeTable(tmpPath, makeHeader(capacity, used, 0), slots);
+                r.bytesAfter = (uint64_t)slotOffset(capacity);
+            }
+        }
+        if (ok) {
+            StatsHeader h = makeHeader(capacity, used, store.header.generation + 1);
+            RawFile out;
+            ok = out.open(tmpPath) && out.writeAt(0, &h, sizeof(h));
+        }
+        store.file.close();
+        ok = ok && replaceFile(tmpPath, filePath);
+        if (!ok) {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        r.compacted = true;
+        if (report) *report = r;
+        return true;
+    }
+
+    // Convert the old text question_stats.txt (question text followed by an
+    // "attempts correct" line) into the store. Questions are matched to the
+    // first question in the bank with the same text; anything that no longer
+    // matches a question, such as counter lines left behind by the old in-place
+    // rewrite, is counted as orphaned and dropped. The store is created with
+    // the migrated counts in one rename, and only if it does not exist yet,
+    // so running the migration again can never count anything twice.
+    static bool migrateText(const std::string &textStatsPath, const std::string &bankPath,
+                            const std::string &storePath, size_t &migrated, size_t &orphaned) {
+        migrated = orphaned = 0;
+        std::ifstream in(textStatsPath);
+        if (!in.is_open()) return false;
+
+        QuestionBank bank;
+        std::unordered_map<std::string, uint32_t> ids;
+        if (bank.load(bankPath, "")) {
+            for (size_t i = 0; i < bank.size(); ++i) {
+                QuestionRecord q = bank.question(i);
+                ids.emplace(std::string(q.text), q.id);
+            }
+        }
+
+        std::unordered_map<uint32_t, QuestionStat> merged;
+        std::string line, pending;
+        bool havePending = false;
+        while (readBankLine(in, line)) {
+            std::istringstream counts(line);
+            long attempts, correct;
+            std::string rest;
+            bool isCounts = (counts >> attempts >> correct) && !(counts >> rest) && attempts >= 0 && correct >= 0;
+            if (!isCounts) {
+                if (havePending) orphaned++;  // Question text with no counters after it
+                pending = line;
+                havePending = true;
+                continue;
+            }
+            if (!havePending) {
+                orphaned++;
+                continue;
+            }
+            havePending = false;
+            auto it = ids.find(pending);
+            if (it == ids.end()) {
+                orphaned++;
+                continue;
+            }
+            QuestionStat &s = merged[it->second];
+            s.id = it->second;
+            s.attempts += (uint32_t)attempts;
+            s.correct += (uint32_t)correct;
+            migrated++;
+        }
+        if (havePending) orphaned++;
+
+        std::vector<QuestionStat> stats;
+        for (const auto &entry : merged) stats.push_back(entry.second);
+        FileLock lock;
+        lock.open(storePath);
+        FileLockGuard guard(lock, true);
+        if (getFileInfo(storePath).exists) return false;  // Already migrated, or recording answers
+        return createFile(storePath, stats, capacityFor(stats.size()));
+    }
+};
+
+// Write-behind front end for the store. Answers are counted in memory and a
+// background thread adds the counts to the store every 'interval', or when
+// flush() asks for it.
+//
+// Counting an answer takes no lock. A question's attempts and correct answers
+// share one 64-bit atomic (attempts in the high half), so one fetch_add
+// records an answer and one exchange takes both counts out together. The
+// counters are sharded: each thread is handed one of a power-of-two number of
+// shards, about one per core, and every shard has its own blocks of
+// counters, so sessions answering the same popular question on different
+// cores add to different cache lines. Reads merge the shards.
+class StatsWriter {
+private:
+    static constexpr size_t BLOCK_IDS = 1024;        // Question IDs per block of counters
+    static constexpr size_t DIRECTORY_SIZE = 8192;   // Blocks per shard; higher IDs take the overflow map
+    static constexpr size_t MAX_SHARDS = 64;
+    static constexpr uint64_t ONE_ATTEMPT = (uint64_t)1 << 32;
+    static constexpr uint64_t CORRECT_MASK = ONE_ATTEMPT - 1;
+
+    struct Block {
+        std::atomic<uint64_t> counts[BLOCK_IDS];
+        Block() {
+            for (std::atomic<uint64_t> &c : counts) c.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    // Blocks are allocated the first time one of their questions is answered
+    struct Shard {
+        std::unique_ptr<std::atomic<Block *>[]> blocks{new std::atomic<Block *>[DIRECTORY_SIZE]()};
+        ~Shard() {
+            if (!blocks) return;
+            for (size_t b = 0; b < DIRECTORY_SIZE; ++b) delete blocks[b].load();
+        }
+    };
+
+    QuestionStatsStore &store;
+    std::chrono::milliseconds interval;
+    std::vector<Shard> shards;
+
+    std::mutex overflowLock;  // Guards overflow: IDs beyond the shards' directories, counts the store refused
+    std::unordered_map<uint32_t, QuestionStat> overflow;
+
+    std::mutex storeLock;  // Held while counts move from the shards to the store, or are read
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+
+    static size_t shardCountFor(unsigned cores) {
+        size_t n = 1;
+        while (n < cores && n < MAX_SHARDS) n *= 2;
+        return n;
+    }
+
+    // The calling thread's counter for a question
+    std::atomic<uint64_t> &counter(uint32_t id) {
+        static std::atomic<size_t> threadsSeen{0};
+        thread_local size_t thread = threadsSeen.fetch_add(1, std::memory_order_relaxed);
+        std::atomic<Block *> &slot = shards[thread & (shards.size() - 1)].blocks[id / BLOCK_IDS];
+        Block *block = slot.load(std::memory_order_acquire);
+        if (!block) {
+            Block *fresh = new Block();
+            if (slot.compare_exchange_strong(block, fresh, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                block = fresh;
+            } else {
+                delete fresh;  // Another thread of this shard got there first
+            }
+        }
+        return block->counts[id % BLOCK_IDS];
+    }
+
+    // Sum the shards' counts, taking them out if 'take' is set. The caller
+    // holds storeLock.
+    std::vector<QuestionStat> gather(bool take) {
+        std::vector<QuestionStat> out;
+        std::vector<QuestionStat> sums(BLOCK_IDS);
+        for (size_t b = 0; b < DIRECTORY_SIZE; ++b) {
+            bool any = false;
+            for (Shard &shard : shards) {
+                Block *block = shard.blocks[b].load(std::memory_order_acquire);
+                if (!block) continue;
+                for (size_t i = 0; i < BLOCK_IDS; ++i) {
+                    uint64_t v = block->counts[i].load(std::memory_order_relaxed);
+                    if (v == 0) continue;
+                    if (take) v = block->counts[i].exchange(0, std::memory_order_relaxed);
+                    sums[i].attempts += (uint32_t)(v >> 32);
+                    sums[i].correct += (uint32_t)(v & CORRECT_MASK);
+                    any = true;
+                }
+            }
+            if (!any) continue;
+            for (size_t i = 0; i < BLOCK_IDS; ++i) {
+                if (sums[i].attempts || sums[i].correct) {
+                    out.push_back(QuestionStat{(uint32_t)(b * BLOCK_IDS + i), sums[i].attempts, sums[i].correct, 0});
+                }
+                sums[i] = QuestionStat{0, 0, 0, 0};
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(overflowLock);
+        for (const auto &entry : overflow) out.push_back(entry.second);
+        if (take) overflow.clear();
+        return out;
+    }
+
+    // Move every count so far into the store. Counts the store could not
+    // take (no lock, disk full) go back into overflow for the next commit.
+    // The caller holds storeLock.
+    void commit() {
+        std::vector<QuestionStat> changes = gather(true);
+        std::vector<QuestionStat> unwritten;
+        if (changes.empty() || store.update(changes, &unwritten)) return;
+        std::lock_guard<std::mutex> lock(overflowLock);
+        for (const QuestionStat &c : unwritten) {
+            QuestionStat &s = overflow[c.id];
+            s.id = c.id;
+            s.attempts += c.attempts;
+            s.correct += c.correct;
+        }
+    }
+
+    void run() {
+#ifndef _WIN32
+        // Signals are for the main thread to handle; a writer killed mid-update would lose answers
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+#endif
+        bool last = false;
+        while (!last) {
+            {
+                std::unique_lock<std::mutex> lock(wakeLock);
+                wake.wait_for(lock, interval, [&] { return stopping; });
+                last = stopping;
+            }
+            std::lock_guard<std::mutex> lock(storeLock);
+            commit();
+        }
+    }
+public:
+    StatsWriter(QuestionStatsStore &s, std::chrono::milliseconds every)
+        : store(s), interval(every), shards(shardCountFor(std::thread::hardware_concurrency())) {
+        worker = std::thread(&StatsWriter::run, this);
+    }
+
+    StatsWriter(const StatsWriter &) = delete;
+    StatsWriter &operator=(const StatsWriter &) = delete;
+
+    // Writes every count still in memory before returning
+    ~StatsWriter() {
+        {
+            std::lock_guard<std::mutex> lock(wakeLock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    // Count one answer; never touches the file
+    void record(uint32_t id, bool correct) {
+        add(id, 1, correct ? 1 : 0);
+    }
+
+    // Count many answers to one question at once
+    void add(uint32_t id, uint32_t attempts, uint32_t correct) {
+        if (id == 0) return;
+        if (id / BLOCK_IDS >= DIRECTORY_SIZE) {
+            std::lock_guard<std::mutex> lock(overflowLock);
+            QuestionStat &s = overflow[id];
+            s.id = id;
+            s.attempts += attempts;
+            s.correct += correct;
+            return;
+        }
+        counter(id).fetch_add(attempts * ONE_ATTEMPT + correct, std::memory_order_relaxed);
+    }
+
+    // Block until every answer counted so far is in the store
+    void flush() {
+        std::lock_guard<std::mutex> lock(storeLock);
+        commit();
+    }
+
+    // Every question's statistics: the store plus the counts still in memory
+    std::vector<QuestionStat> all() {
+        std::lock_guard<std::mutex> lock(storeLock);
+        std::vector<QuestionStat> stored = store.all();
+        std::unordered_map<uint32_t, size_t> at;
+        for (size_t i = 0; i < stored.size(); ++i) at[stored[i].id] = i;
+        bool added = false;
+        for (const QuestionStat &p : gather(false)) {
+            auto it = at.find(p.id);
+            if (it == at.end()) {
+                stored.push_back(p);
+                added = true;
+            } else {
+                stored[it->second].attempts += p.attempts;
+                stored[it->second].correct += p.correct;
+            }
+        }
+        if (added) {
+            std::sort(stored.begin(), stored.end(), [](const QuestionStat &a, const QuestionStat &b) { return a.id < b.id; });
+        }
+        return stored;
+    }
+};
+
+// Background compaction of the store. A thread looks at the file every
+// 'interval' and compacts it (see QuestionStatsStore::compact) once it takes
+// more than twice the space of its entries. Every entry is kept: whether a
+// question is gone for good is only decided when someone asks for it (final
+// --compact-stats), never from a bank that may be half edited.
+class StatsCompactor {
+private:
+    std::string path;
+    std::chrono::milliseconds interval;
+
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread worker;
+
+    void run() {
+#ifndef _WIN32
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+#endif
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wakeLock);
+                if (wake.wait_for(lock, interval, [&] { return stopping; })) return;
+            }
+            QuestionStatsStore::compact(path, nullptr);
+        }
+    }
+public:
+    StatsCompactor(const std::string &filePath, std::chrono::milliseconds every) : path(filePath), interval(every) {
+        worker = std::thread(&StatsCompactor::run, this);
+    }
+
+    StatsCompactor(const StatsCompactor &) = delete;
+    StatsCompactor &operator=(const StatsCompactor &) = delete;
+
+    // Waits for a compaction under way to finish
+    ~StatsCompactor() {
+        {
+            std::lock_guard<std::mutex> lock(wakeLock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+};
+
+#endif
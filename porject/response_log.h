@@ -0,0 +1,129 @@
+#ifndef RESPONSE_LOG_H
+#define RESPONSE_LOG_H
+
+// Log of every answer given, kept for item analysis (see item_analysis.h).
+//
+// responses.dat is a small header followed by fixed-width records, one per
+// answered question. The answers of one quiz attempt are stored next to each
+// other and the first one is flagged, so a reader can split the log at any
+// attempt. Every append is a single write made under the file lock, so
+// attempts from several quiz processes never interleave, and a record torn
+// by a crash is cut off by the next append. Nothing is fsynced: a power cut
+// can only cost the last few attempts of analysis data.
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "platform.h"
+
+const char RESPONSE_LOG_MAGIC[8] = {'Q', 'U', 'I', 'Z', 'R', 'S', 'P', '\0'};
+const uint32_t RESPONSE_LOG_VERSION = 1;
+const uint8_t RESPONSE_CORRECT = 1;
+const uint8_t RESPONSE_FIRST = 2;  // First answer of an attempt
+
+struct ResponseLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct ResponseRecord {
+    uint32_t question;  // Question ID
+    uint8_t choice;     // Option picked, 1-based; 0 for time up or no valid option
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+static_assert(sizeof(ResponseLogHeader) == 16, "ResponseLogHeader layout changed");
+static_assert(sizeof(ResponseRecord) == 8, "ResponseRecord layout changed");
+
+// Record of one answer; choices outside 1..maxChoice are stored as 0
+inline ResponseRecord makeResponse(uint32_t question, int choice, int maxChoice, bool correct) {
+    ResponseRecord r = {};
+    r.question = question;
+    r.choice = (uint8_t)(choice >= 1 && choice <= maxChoice ? choice : 0);
+    r.flags = correct ? RESPONSE_CORRECT : 0;
+    return r;
+}
+
+inline bool validResponseLogHeader(const ResponseLogHeader &h) {
+    return memcmp(h.magic, RESPONSE_LOG_MAGIC, sizeof(h.magic)) == 0 && h.version == RESPONSE_LOG_VERSION;
+}
+
+class ResponseLog {
+private:
+    std::string path;
+    std::mutex appendLock;  // Threads share the FileLock, so it does not keep them apart
+    FileLock lock;
+    bool opened = false;
+public:
+    // Create the log if it is missing and check that it is a response log
+    bool open(const std::string &filePath) {
+        path = filePath;
+        opened = false;
+        lock.open(path);
+        FileLockGuard guard(lock, true);
+        RawFile file;
+        if (!file.open(path)) return false;
+        ResponseLogHeader h = {};
+        if (file.size() == 0) {
+            memcpy(h.magic, RESPONSE_LOG_MAGIC, sizeof(h.magic));
+            h.version = RESPONSE_LOG_VERSION;
+            if (!file.writeAt(0, &h, sizeof(h))) return false;
+        } else if (!file.readAt(0, &h, sizeof(h)) || !validResponseLogHeader(h)) {
+            return false;
+        }
+        opened = true;
+        return true;
+    }
+
+    bool isOpen() const { return opened; }
+
+    // Append one or more whole attempts; each attempt's first answer must
+    // carry RESPONSE_FIRST. Safe to call from several threads.
+    bool append(const std::vector<ResponseRecord> &records) {
+        if (!opened) return false;
+        if (records.empty()) return true;
+        std::lock_guard<std::mutex> threadGuard(appendLock);
+        FileLockGuard guard(lock, true);
+        RawFile file;
+        if (!file.open(path)) return false;
+        uint64_t size = file.size();
+        if (size < sizeof(ResponseLogHeader)) return false;
+        uint64_t end = size - (size - sizeof(ResponseLogHeader)) % sizeof(ResponseRecord);
+        if (end != size && !file.truncate(end)) return false;  // Torn by a crash
+        return file.writeAt(end, records.data(), records.size() * sizeof(ResponseRecord));
+    }
+};
+
+// The records of a response log, mapped for reading
+class ResponseLogReader {
+private:
+    MappedFile map;
+    size_t count = 0;
+public:
+    // A missing or empty log reads as no records
+    bool open(const std::string &path) {
+        count = 0;
+        if (!map.open(path)) {
+            FileInfo info = getFileInfo(path);
+            return !info.exists || info.size == 0;
+        }
+        ResponseLogHeader h;
+        if (map.size() < sizeof(h)) return false;
+        memcpy(&h, map.data(), sizeof(h));
+        if (!validResponseLogHeader(h)) return false;
+        count = (map.size() - sizeof(h)) / sizeof(ResponseRecord);  // Leaves out a torn record
+        return true;
+    }
+
+    const ResponseRecord *records() const {
+        return count ? reinterpret_cast<const ResponseRecord *>(map.data() + sizeof(ResponseLogHeader)) : nullptr;
+    }
+    size_t size() const { return count; }
+};
+
+#endif
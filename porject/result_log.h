@@ -0,0 +1,367 @@
+#ifndef RESULT_LOG_H
+#define RESULT_LOG_H
+
+// Crash-safe log of quiz results in front of leaderboard.txt.
+//
+// Every result is first appended to leaderboard.wal as a length-prefixed,
+// CRC-32 checked record. A background thread writes the waiting results in
+// batches and calls fsync once per batch (group commit); append() returns
+// once the result's batch is on the disk. A batch goes out when batchSize
+// results are waiting or the oldest one has waited maxDelay.
+//
+// On open the log is scanned and a torn record left by a crash is cut off.
+// The results in the log are then moved into leaderboard.txt (compaction),
+// which also happens whenever compactEvery results have piled up and when
+// compact() is called. Compaction marks the log header before touching
+// leaderboard.txt, so a crash during it is finished on the next open without
+// losing or duplicating rows.
+//
+// Several quiz processes can log into the same files. Each holds the lock on
+// leaderboard.wal while it writes a batch or compacts, and first reopens the
+// log to find where the other processes left it. Compaction also holds the
+// lock on leaderboard.txt, which readers of the leaderboard take shared.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#endif
+
+#include "leaderboard.h"
+#include "platform.h"
+
+const char RESULT_LOG_MAGIC[8] = {'Q', 'U', 'I', 'Z', 'W', 'A', 'L', '\0'};
+const uint32_t RESULT_LOG_VERSION = 1;
+const uint32_t RESULT_LOG_NORMAL = 0;
+const uint32_t RESULT_LOG_COMPACTING = 1;   // Rows are being copied into leaderboard.txt
+const uint32_t RESULT_LOG_MAX_RECORD = 64 * 1024;
+
+struct ResultLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t state;
+    uint64_t compactBase;   // Size of leaderboard.txt when the compaction started
+    uint64_t reserved;
+};
+
+struct ResultRecordHeader {
+    uint32_t length;        // Bytes of payload that follow
+    uint32_t checksum;      // CRC-32 of the payload
+};
+
+static_assert(sizeof(ResultLogHeader) == 32, "ResultLogHeader layout changed");
+static_assert(sizeof(ResultRecordHeader) == 8, "ResultRecordHeader layout changed");
+
+inline uint32_t crc32(const void *data, size_t length) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < length; ++i) c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+class ResultLog {
+private:
+    // How a batch went, shared by the append() calls waiting on it
+    struct BatchOutcome {
+        bool done = false;
+        bool ok = false;
+    };
+
+    std::string logPath;
+    std::string boardPath;
+    size_t batchSize;
+    std::chrono::milliseconds maxDelay;
+    size_t compactEvery;
+
+    std::mutex fileLock;       // Held while the log or leaderboard.txt is written
+    FileLock logLock;          // The same, across processes
+    FileLock boardLock;
+    RawFile log;
+    ResultLogHeader header;    // As it is on the disk
+    uint64_t logEnd = 0;       // Where the next record goes
+    size_t logRecords = 0;     // Records in the log not yet compacted
+
+    std::mutex queueLock;
+    std::condition_variable wake;       // Signals the commit thread
+    std::condition_variable committed;  // Signals append() callers
+    std::string pending;                // Encoded records waiting for a batch
+    size_t pendingCount = 0;
+    std::shared_ptr<BatchOutcome> pendingOutcome = std::make_shared<BatchOutcome>();
+    bool stopping = false;
+    std::thread worker;
+
+    static void encode(std::string &out, const std::string &name, int id, int score) {
+        size_t nameLength = std::min<size_t>(name.size(), RESULT_LOG_MAX_RECORD - 8);  // Longer would read as torn
+        uint32_t length = (uint32_t)(8 + nameLength);
+        std::string payload(length, '\0');
+        int32_t fields[2] = {id, score};
+        memcpy(&payload[0], fields, sizeof(fields));
+        memcpy(&payload[8], name.data(), nameLength);
+        ResultRecordHeader h = {length, crc32(payload.data(), payload.size())};
+        out.append((const char *)&h, sizeof(h));
+        out += payload;
+    }
+
+    static ResultLogHeader makeHeader(uint32_t state, uint64_t base) {
+        ResultLogHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, RESULT_LOG_MAGIC, sizeof(h.magic));
+        h.version = RESULT_LOG_VERSION;
+        h.state = state;
+        h.compactBase = base;
+        return h;
+    }
+
+    // Turn every complete record after the header into leaderboard rows, or
+    // only count them when rows is null. Returns where the valid records end.
+    uint64_t readRecords(std::string *rows, size_t &count) {
+        if (rows) rows->clear();
+        count = 0;
+        uint64_t size = log.size();
+        if (size <= sizeof(ResultLogHeader)) return sizeof(ResultLogHeader);
+        std::string body((size_t)(size - sizeof(ResultLogHeader)), '\0');
+        if (!log.readAt(sizeof(ResultLogHeader), &body[0], body.size())) return sizeof(ResultLogHeader);
+
+        size_t pos = 0;
+        while (pos + sizeof(ResultRecordHeader) <= body.size()) {
+            ResultRecordHeader h;
+            memcpy(&h, body.data() + pos, sizeof(h));
+            size_t start = pos + sizeof(h);
+            if (h.length < 8 || h.length > RESULT_LOG_MAX_RECORD || start + h.length > body.size()) break;
+            if (crc32(body.data() + start, h.length) != h.checksum) break;
+            if (rows) {
+                int32_t fields[2];
+                memcpy(fields, body.data() + start, sizeof(fields));
+                appendLeaderboardRow(*rows, body.substr(start + 8, h.length - 8), fields[0], fields[1]);
+            }
+            pos = start + h.length;
+            ++count;
+        }
+        return sizeof(ResultLogHeader) + pos;
+    }
+
+    // Put 'rows' into leaderboard.txt at 'base', unless an earlier attempt
+    // that crashed already got them there
+    bool applyRows(const std::string &rows, uint64_t base) {
+        RawFile board;
+        if (!board.open(boardPath)) return false;
+        uint64_t size = board.size();
+        if (size < base) base = size;  // The file was cut short by hand; add at the end
+        if (size >= base + rows.size()) {
+            std::string there(rows.size(), '\0');
+            if (rows.empty() || (board.readAt(base, &there[0], there.size()) && there == rows)) return true;
+        }
+        if (size > base && !board.truncate(base)) return false;  // Half-written rows from the crash
+        return board.writeAt(base, rows.data(), rows.size()) && board.sync();
+    }
+
+    // Replace the log with an empty one
+    bool resetLog() {
+        std::string tmpPath = tempPathFor(logPath);
+        ResultLogHeader h = makeHeader(RESULT_LOG_NORMAL, 0);
+        {
+            RawFile tmp;
+            if (!tmp.open(tmpPath) || !tmp.truncate(0) || !tmp.writeAt(0, &h, sizeof(h)) || !tmp.sync()) return false;
+        }
+        log.close();  // Windows cannot rename over an open file
+        if (!replaceFile(tmpPath, logPath)) {
+            log.open(logPath);
+            return false;
+        }
+        syncDirectoryOf(logPath);
+        if (!log.open(logPath)) return false;
+        header = h;
+        logEnd = sizeof(ResultLogHeader);
+        logRecords = 0;
+        return true;
+    }
+
+    // Reopen the log, which another process may have appended to or replaced,
+    // and find where its records end. A torn record left by a crash is cut
+    // off. fileLock and logLock must be held.
+    bool refreshLocked(uint64_t *truncatedBytes = nullptr) {
+        log.close();
+        if (!log.open(logPath)) return false;
+
+        ResultLogHeader h;
+        if (log.size() < sizeof(h) || !log.readAt(0, &h, sizeof(h)) ||
+            memcmp(h.magic, RESULT_LOG_MAGIC, sizeof(h.magic)) != 0 || h.version != RESULT_LOG_VERSION) {
+            log.close();
+            return false;  // Not a log this version can read; leave it alone
+        }
+        header = h;
+
+        size_t count;
+        uint64_t end = readRecords(nullptr, count);
+        uint64_t size = log.size();
+        if (end < size) {
+            if (!log.truncate(end) || !log.sync()) return false;
+            if (truncatedBytes) *truncatedBytes = size - end;
+        }
+        logEnd = end;
+        logRecords = count;
+        return true;
+    }
+
+    // Move the logged results into leaderboard.txt, or finish a compaction
+    // that was cut short. fileLock and logLock must be held.
+    bool compactLocked() {
+        std::string rows;
+        size_t count;
+        readRecords(&rows, count);
+        if (count == 0 && header.state == RESULT_LOG_NORMAL) return true;
+
+        FileLockGuard board(boardLock, true);
+        if (header.state == RESULT_LOG_NORMAL) {
+            ResultLogHeader h = makeHeader(RESULT_LOG_COMPACTING, getFileInfo(boardPath).size);
+            if (!log.writeAt(0, &h, sizeof(h)) || !log.sync()) return false;
+            header = h;
+        }
+        return applyRows(rows, header.compactBase) && resetLog();
+    }
+
+    bool commitBatch(const std::string &batch, size_t count) {
+        std::lock_guard<std::mutex> lock(fileLock);
+        FileLockGuard guard(logLock, true);
+        if (!refreshLocked() || !log.writeAt(logEnd, batch.data(), batch.size()) || !log.sync()) {
+            if (log.isOpen()) log.truncate(logEnd);  // Drop whatever part of the batch got written
+            return false;
+        }
+        logEnd += batch.size();
+        logRecords += count;
+        if (logRecords >= compactEvery) {
+            compactLocked();  // The results are safe in the log either way
+        }
+        return true;
+    }
+
+    void run() {
+#ifndef _WIN32
+        // Signals are for the main thread to handle; a commit cut short would lose results
+        sigset_t all;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, nullptr);
+#endif
+        std::unique_lock<std::mutex> lock(queueLock);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || pendingCount > 0; });
+            if (pendingCount == 0) break;  // Stopping with nothing left to write
+
+            // The oldest waiting result sets the deadline for this batch
+            auto deadline = std::chrono::steady_clock::now() + maxDelay;
+            wake.wait_until(lock, deadline, [&] { return stopping || pendingCount >= batchSize; });
+
+            std::string batch;
+            batch.swap(pending);
+            size_t count = pendingCount;
+            pendingCount = 0;
+            std::shared_ptr<BatchOutcome> outcome;
+            outcome.swap(pendingOutcome);
+            pendingOutcome = std::make_shared<BatchOutcome>();
+
+            lock.unlock();
+            bool ok = commitBatch(batch, count);
+            lock.lock();
+
+            outcome->ok = ok;
+            outcome->done = true;  // Freed with the last caller waiting on it, however many batches fail
+            committed.notify_all();
+        }
+    }
+
+    // Queue 'added' results just encoded into pending, and wait for their
+    // batch to be written. The caller holds queueLock.
+    bool submit(std::unique_lock<std::mutex> &lock, size_t added) {
+        pendingCount += added;
+        std::shared_ptr<BatchOutcome> outcome = pendingOutcome;
+        if (pendingCount == added || pendingCount >= batchSize) wake.notify_one();  // Start the clock, or the batch is full
+
+        committed.wait(lock, [&] { return outcome->done; });
+        return outcome->ok;
+    }
+
+    void stop() {
+        if (!worker.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(queueLock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+public:
+    ResultLog(size_t batch, std::chrono::milliseconds delay, size_t compactAfter)
+        : batchSize(batch ? batch : 1), maxDelay(delay), compactEvery(compactAfter ? compactAfter : 1) {}
+
+    ResultLog(const ResultLog &) = delete;
+    ResultLog &operator=(const ResultLog &) = delete;
+
+    // Writes every waiting result before returning
+    ~ResultLog() { stop(); }
+
+    // Open the log, recover it after a crash and move its results into
+    // leaderboard.txt. truncatedBytes is what was cut off a torn record.
+    bool open(const std::string &logFile, const std::string &boardFile, uint64_t *truncatedBytes = nullptr) {
+        stop();
+        stopping = false;
+        logPath = logFile;
+        boardPath = boardFile;
+        if (truncatedBytes) *truncatedBytes = 0;
+
+        std::lock_guard<std::mutex> lock(fileLock);
+        logLock.open(logPath);
+        boardLock.open(boardPath);
+        FileLockGuard guard(logLock, true);
+        if (!getFileInfo(logPath).exists && !resetLog()) return false;
+        if (!refreshLocked(truncatedBytes) || !compactLocked()) return false;
+
+        worker = std::thread(&ResultLog::run, this);
+        return true;
+    }
+
+    // Log one result. Returns once it is on the disk, false if it could not be written.
+    bool append(const std::string &name, int id, int score) {
+        std::unique_lock<std::mutex> lock(queueLock);
+        if (!worker.joinable()) return false;
+        encode(pending, name, id, score);
+        return submit(lock, 1);
+    }
+
+    // Log many results together, such as a file of graded answer sheets.
+    // They go out in one batch with one fsync; returns once all are on the disk.
+    bool append(const std::vector<LeaderboardEntry> &results) {
+        if (results.empty()) return true;
+        std::unique_lock<std::mutex> lock(queueLock);
+        if (!worker.joinable()) return false;
+        for (const LeaderboardEntry &r : results) encode(pending, r.name, r.id, r.score);
+        return submit(lock, results.size());
+    }
+
+    // Move everything in the log into leaderboard.txt now
+    bool compact() {
+        std::lock_guard<std::mutex> lock(fileLock);
+        FileLockGuard guard(logLock, true);
+        return log.isOpen() && refreshLocked() && compactLocked();
+    }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+// Screens built in memory and sent to the terminal in one piece.
+//
+// A menu, a question with its options or a leaderboard page is collected in
+// a Screen and written with a single write() call, instead of one write per
+// line or per character. Everything else printed with cout stays buffered
+// until ConsoleInput flushes it before waiting for input.
+//
+// Plain mode leaves out the decoration (boxes and the big title), which is
+// what you want when the output is piped into another program.
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+class Screen {
+private:
+    std::ostringstream out;
+
+    static bool &plainMode() {
+        static bool plain = false;
+        return plain;
+    }
+public:
+    static void setPlain(bool plain) { plainMode() = plain; }
+    static bool isPlain() { return plainMode(); }
+
+    template <typename T>
+    Screen &operator<<(const T &value) {
+        out << value;
+        return *this;
+    }
+
+    // The text in a box of dashes, or just the text in plain mode
+    void boxed(const std::string &text) {
+        if (isPlain()) {
+            out << text << "\n";
+            return;
+        }
+        std::string border(text.length() + 4, '-');
+        out << "\n" << border << "\n| " << text << " |\n" << border << "\n";
+    }
+
+    // Large "QUIZ" title in ASCII art, left out in plain mode
+    void title() {
+        if (isPlain()) return;
+        out << "\n"
+            << "  QQQQQ   U   U   III   ZZZZZ\n"
+            << " Q     Q  U   U    I       Z\n"
+            << " Q     Q  U   U    I      Z\n"
+            << " Q   Q Q  U   U    I     Z\n"
+            << "  QQQQQ   UUUUU   III   ZZZZZ\n"
+            << "\n";
+    }
+
+    std::string str() const { return out.str(); }
+
+    // Write the screen out and start over with an empty one
+    void show() {
+        std::string text = out.str();
+        out.str("");
+        std::cout.flush();  // Whatever was printed before the screen goes first
+#ifdef _WIN32
+        std::cout.write(text.data(), (std::streamsize)text.size());
+        std::cout.flush();
+#else
+        size_t done = 0;
+        while (done < text.size()) {
+            ssize_t n = write(1, text.data() + done, text.size() - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += (size_t)n;
+        }
+#endif
+    }
+};
+
+#endif
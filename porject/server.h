@@ -0,0 +1,585 @@
+#ifndef QUIZ_SERVER_H
+#define QUIZ_SERVER_H
+
+// Multi-session quiz server.
+//
+// One process keeps the question bank cached and serves many students over a
+// Unix domain socket or a loopback TCP port. The protocol is plain lines: the
+// client sends one line per answer or menu choice, and the server sends back
+// the same text the interactive program prints. client.cpp is a thin terminal
+// for it.
+//
+// A single thread runs the epoll loop: it accepts connections, reads input,
+// writes pending output and fires per-question deadlines. Each session is a
+// small state machine, advanced by a fixed pool of worker threads. A session
+// is handled by at most one worker at a time, so session state is only
+// touched with the session's own lock held.
+//
+// Each quiz runs on the bank snapshot it started with (see bank_cache.h), so
+// questions added while the server runs reach new quizzes only.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bank_cache.h"
+#include "console.h"
+#include "menu.h"
+#include "question_bank.h"
+#include "question_kinds.h"
+#include "response_log.h"
+#include "trace.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+struct QuizServerConfig {
+    std::string unixPath = "quiz.sock";  // Used when tcpPort is 0
+    int tcpPort = 0;                     // Listen on 127.0.0.1:tcpPort instead
+    size_t workers = 0;                  // 0 = one per core
+    int timeLimitSeconds = 10;           // Per question
+};
+
+// What the server needs from the rest of the quiz system
+struct QuizServerHooks {
+    std::function<void(uint32_t questionId, bool correct)> recordAnswer;
+    std::function<void(const std::string &name, int id, int score)> saveResult;
+    std::function<void(const std::vector<ResponseRecord> &attempt)> saveResponses;  // Once per finished quiz
+    std::function<std::string()> leaderboardText;
+};
+
+#ifndef _WIN32
+
+class QuizServer {
+private:
+    enum SessionState { STATE_MENU, STATE_DRAW_COUNT, STATE_NAME, STATE_ID, STATE_QUESTION };
+
+    struct Session {
+        int fd;
+        uint64_t key;
+        std::mutex lock;
+        std::string inBuf, outBuf;
+        std::deque<std::string> lines;  // Complete input lines not yet handled
+        bool started = false;
+        bool timedOut = false;
+        size_t linesBeforeDeadline = 0;  // Lines in 'lines' that arrived before the deadline fired
+        uint64_t timedOutSeq = 0;        // Question the deadline was for
+        bool scheduled = false;  // Queued for or being handled by a worker
+        bool closing = false;    // Close once outBuf is sent
+        bool inputClosed = false;  // Client sent EOF; finish its queued lines, then close
+
+        SessionState state = STATE_MENU;
+        std::string name;
+        int studentId = 0;
+        size_t drawCount = 0;
+        std::shared_ptr<const BankSnapshot> bank;  // Version of the bank the running quiz uses
+        std::vector<size_t> order;  // Questions of the running quiz
+        size_t next = 0;
+        int score = 0;
+        std::vector<ResponseRecord> responses;  // Answers of the running quiz
+        uint64_t questionSeq = 0;   // Identifies the deadline of the current question
+
+        Session(int f, uint64_t k) : fd(f), key(k) {}
+        ~Session() { ::close(fd); }
+    };
+
+    struct Timer {
+        std::chrono::steady_clock::time_point at;
+        uint64_t key;
+        uint64_t seq;
+        bool operator>(const Timer &o) const { return at > o.at; }
+    };
+
+    static constexpr uint64_t LISTEN_KEY = 1;
+    static constexpr uint64_t WAKE_KEY = 2;
+    static constexpr uint64_t SIGNAL_KEY = 3;
+    static constexpr size_t MAX_LINE = 64 * 1024;
+
+    BankCache &banks;
+    QuizServerConfig config;
+    QuizServerHooks hooks;
+
+    int epollFd = -1, listenFd = -1, wakeFd = -1, signalFd = -1;
+    uint64_t nextKey = 16;
+    std::unordered_map<uint64_t, std::shared_ptr<Session>> sessions;  // Event loop thread only
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+
+    std::mutex timerLock;
+    std::vector<Timer> newTimers;  // Deadlines set by workers, picked up by the loop
+
+    std::mutex workLock;
+    std::condition_variable workReady;
+    std::deque<std::shared_ptr<Session>> work;
+    bool stopping = false;
+    std::vector<std::thread> pool;
+
+    // --- Rendering, same text as the interactive program ---
+
+    static std::string boxed(const std::string &text) {
+        std::string border(text.length() + 4, '-');
+        return "\n" + border + "\n| " + text + " |\n" + border + "\n";
+    }
+
+    // The served entries of the main menu, numbered as in the interactive program
+    static std::string menu() {
+        std::string out = "\n";
+        for (const MenuItem &item : MAIN_MENU) {
+            if (item.served) out += boxed(menuEntry(item));
+        }
+        return out + "\nEnter your choice: ";
+    }
+
+    void showQuestion(Session &s) {
+        TRACE_SPAN(TRACE_RENDER);
+        QuestionRecord q = s.bank->bank.question(s.order[s.next]);
+        s.outBuf += '\n';
+        renderQuestion(s.outBuf, q);
+        s.outBuf += "You have " + std::to_string(config.timeLimitSeconds) + " seconds to answer.\nYour answer: ";
+
+        s.questionSeq++;
+        Timer t = {std::chrono::steady_clock::now() + std::chrono::seconds(config.timeLimitSeconds), s.key, s.questionSeq};
+        {
+            std::lock_guard<std::mutex> lock(timerLock);
+            newTimers.push_back(t);
+        }
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0) {
+            // The loop is already awake
+        }
+    }
+
+    void finishQuiz(Session &s) {
+        s.outBuf += "Quiz completed! Your score: " + std::to_string(s.score) + "\n";
+        if (hooks.saveResult) hooks.saveResult(s.name, s.studentId, s.score);
+        if (hooks.saveResponses && !s.responses.empty()) {
+            s.responses[0].flags |= RESPONSE_FIRST;
+            hooks.saveResponses(s.responses);
+        }
+        s.responses.clear();
+        s.state = STATE_MENU;
+        s.bank.reset();
+        s.outBuf += menu();
+    }
+
+    // 'choice' is the option picked, 0 when time ran out
+    void answered(Session &s, bool correct, int choice) {
+        QuestionRecord q = s.bank->bank.question(s.order[s.next]);
+        if (correct) s.score += 10;
+        if (hooks.recordAnswer) hooks.recordAnswer(q.id, correct);
+        s.responses.push_back(makeResponse(q.id, choice, questionChoices(q), correct));
+        s.outBuf += "\n";
+        s.next++;
+        if (s.next < s.order.size()) {
+            showQuestion(s);
+        } else {
+            finishQuiz(s);
+        }
+    }
+
+    void startQuiz(Session &s) {
+        s.outBuf += "Name: " + s.name + "\nID: " + std::to_string(s.studentId) + "\nRole: Student\n";
+        s.bank = banks.snapshot();
+        if (!s.bank) {
+            s.state = STATE_MENU;
+            s.outBuf += "Unable to open file for reading!\n" + menu();
+            return;
+        }
+        const QuestionBank &bank = s.bank->bank;
+        s.order.clear();
+        if (s.drawCount > 0) {
+            thread_local std::mt19937_64 rng(std::random_device{}());
+            s.order = sampleQuestionOrdinals(bank.size(), s.drawCount, rng);
+        } else {
+            for (size_t i = 0; i < bank.size(); ++i) s.order.push_back(i);
+        }
+        s.next = 0;
+        s.score = 0;
+        s.responses.clear();
+        s.state = STATE_QUESTION;
+        if (s.order.empty()) {
+            finishQuiz(s);
+        } else {
+            showQuestion(s);
+        }
+    }
+
+    void handleLine(Session &s, const std::string &line) {
+        switch (s.state) {
+        case STATE_MENU: {
+            int choice = ConsoleInput::parseInt(line);
+            if (choice == MENU_START_QUIZ || choice == MENU_RANDOM_QUIZ) {
+                s.drawCount = 0;
+                if (choice == MENU_RANDOM_QUIZ) {
+                    s.state = STATE_DRAW_COUNT;
+                    s.outBuf += "How many questions should be drawn? ";
+                } else {
+                    s.state = STATE_NAME;
+                    s.outBuf += "Enter your name: ";
+                }
+            } else if (choice == MENU_LEADERBOARD) {
+                if (hooks.leaderboardText) s.outBuf += hooks.leaderboardText();
+                s.outBuf += menu();
+            } else if (choice == MENU_EXIT) {
+                s.outBuf += "Exiting the system...\n";
+                s.closing = true;
+            } else {
+                s.outBuf += "Invalid choice, please try again!\n" + menu();
+            }
+            break;
+        }
+        case STATE_DRAW_COUNT: {
+            int count = ConsoleInput::parseInt(line);
+            if (count > 0) {
+                s.drawCount = (size_t)count;
+                s.state = STATE_NAME;
+                s.outBuf += "Enter your name: ";
+            } else {
+                s.state = STATE_MENU;
+                s.outBuf += "Invalid number of questions!\n" + menu();
+            }
+            break;
+        }
+        case STATE_NAME:
+            s.name = line;
+            s.state = STATE_ID;
+            s.outBuf += "Enter your student ID: ";
+            break;
+        case STATE_ID:
+            s.studentId = ConsoleInput::parseInt(line);
+            startQuiz(s);
+            break;
+        case STATE_QUESTION: {
+            int choice = ConsoleInput::parseInt(line);
+            bool correct = checkQuestionAnswer(s.bank->bank.question(s.order[s.next]), choice);
+            s.outBuf += correct ? "Correct!\n" : "Wrong!\n";
+            answered(s, correct, choice);
+            break;
+        }
+        }
+    }
+
+    // --- Worker side ---
+
+    void schedule(const std::shared_ptr<Session> &s) {  // Caller holds s->lock
+        if (s->scheduled) return;
+        s->scheduled = true;
+        {
+            std::lock_guard<std::mutex> lock(workLock);
+            work.push_back(s);
+        }
+        workReady.notify_one();
+    }
+
+    // Send what the socket accepts now; the loop sends the rest on EPOLLOUT
+    void sendPending(Session &s) {  // Caller holds s.lock
+        while (!s.outBuf.empty()) {
+            ssize_t n = send(s.fd, s.outBuf.data(), s.outBuf.size(), MSG_NOSIGNAL);
+            if (n > 0) {
+                s.outBuf.erase(0, (size_t)n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                break;
+            }
+        }
+        epoll_event ev = {};
+        ev.data.u64 = s.key;
+        ev.events = (s.inputClosed ? 0u : (uint32_t)EPOLLIN) | (s.outBuf.empty() ? 0u : (uint32_t)EPOLLOUT);
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, s.fd, &ev);
+        if (s.closing && s.outBuf.empty()) shutdown(s.fd, SHUT_RDWR);  // Loop sees the hangup and drops it
+    }
+
+    void process(const std::shared_ptr<Session> &sp) {
+        Session &s = *sp;
+        std::lock_guard<std::mutex> lock(s.lock);
+        if (!s.started) {
+            s.started = true;
+            s.outBuf += boxed("Welcome to the Quiz Management System!") + menu();
+        }
+        while (!s.closing && (s.timedOut || !s.lines.empty())) {
+            if (s.timedOut && s.linesBeforeDeadline == 0) {
+                // An answer that arrived in time has been handled first and moved the quiz on
+                s.timedOut = false;
+                if (s.state == STATE_QUESTION && s.questionSeq == s.timedOutSeq) {
+                    s.outBuf += "\nTime Up!\n";
+                    answered(s, false, 0);
+                }
+            } else {
+                if (s.timedOut) s.linesBeforeDeadline--;
+                std::string line = s.lines.front();
+                s.lines.pop_front();
+                handleLine(s, line);
+            }
+        }
+        if (s.inputClosed && s.lines.empty()) s.closing = true;
+        s.scheduled = false;
+        sendPending(s);
+    }
+
+    void workerLoop() {
+        while (true) {
+            std::shared_ptr<Session> s;
+            {
+                std::unique_lock<std::mutex> lock(workLock);
+                workReady.wait(lock, [&] { return stopping || !work.empty(); });
+                if (stopping) return;
+                s = work.front();
+                work.pop_front();
+            }
+            process(s);
+        }
+    }
+
+    // --- Event loop side ---
+
+    bool listen() {
+        if (config.tcpPort > 0) {
+            listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int on = 1;
+            setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((uint16_t)config.tcpPort);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (listenFd < 0 || bind(listenFd, (sockaddr *)&addr, sizeof(addr)) != 0) return false;
+        } else {
+            listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            sockaddr_un addr = {};
+            addr.sun_family = AF_UNIX;
+            if (config.unixPath.size() >= sizeof(addr.sun_path)) return false;
+            memcpy(addr.sun_path, config.unixPath.c_str(), config.unixPath.size() + 1);
+            unlink(config.unixPath.c_str());  // Left over from a previous run
+            if (listenFd < 0 || bind(listenFd, (sockaddr *)&addr, sizeof(addr)) != 0) return false;
+        }
+        return ::listen(listenFd, SOMAXCONN) == 0;
+    }
+
+    void watch(int fd, uint64_t key) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = key;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            std::shared_ptr<Session> s = std::make_shared<Session>(fd, nextKey++);
+            sessions[s->key] = s;
+            epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.u64 = s->key;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            std::lock_guard<std::mutex> lock(s->lock);
+            schedule(s);  // Sends the welcome screen
+        }
+    }
+
+    void drop(uint64_t key) {
+        auto it = sessions.find(key);
+        if (it == sessions.end()) return;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second->fd, nullptr);
+        std::lock_guard<std::mutex> lock(it->second->lock);
+        it->second->closing = true;  // A worker still holding it will stop handling input
+        sessions.erase(it);
+    }
+
+    // Returns false when the session should be dropped
+    bool readInput(const std::shared_ptr<Session> &s) {
+        std::lock_guard<std::mutex> lock(s->lock);
+        char chunk[4096];
+        bool open = true;
+        while (true) {
+            ssize_t n = recv(s->fd, chunk, sizeof(chunk), 0);
+            if (n > 0) {
+                s->inBuf.append(chunk, (size_t)n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n == 0) {
+                // Stop reading; the worker answers what was sent and then closes
+                s->inputClosed = true;
+                epoll_event ev = {};
+                ev.data.u64 = s->key;
+                ev.events = s->outBuf.empty() ? 0u : (uint32_t)EPOLLOUT;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, s->fd, &ev);
+                schedule(s);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                open = false;
+            }
+            break;
+        }
+        size_t end;
+        while ((end = s->inBuf.find('\n')) != std::string::npos) {
+            std::string line = s->inBuf.substr(0, end);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            s->lines.push_back(line);
+            s->inBuf.erase(0, end + 1);
+        }
+        if (s->inBuf.size() > MAX_LINE) open = false;
+        if (!s->lines.empty()) schedule(s);
+        return open;
+    }
+
+    void collectTimers() {
+        std::lock_guard<std::mutex> lock(timerLock);
+        for (const Timer &t : newTimers) timers.push(t);
+        newTimers.clear();
+    }
+
+    void fireTimers() {
+        collectTimers();
+        auto now = std::chrono::steady_clock::now();
+        while (!timers.empty() && timers.top().at <= now) {
+            Timer t = timers.top();
+            timers.pop();
+            auto it = sessions.find(t.key);
+            if (it == sessions.end()) continue;
+            std::shared_ptr<Session> s = it->second;
+            std::lock_guard<std::mutex> lock(s->lock);
+            // Only if the student is still on the question this deadline was set for
+            if (s->state == STATE_QUESTION && s->questionSeq == t.seq && !s->closing && !s->timedOut) {
+                // Input is read before deadlines fire, so every line queued now came in time
+                s->timedOut = true;
+                s->timedOutSeq = t.seq;
+                s->linesBeforeDeadline = s->lines.size();
+                schedule(s);
+            }
+        }
+    }
+
+    int nextTimeoutMs() {
+        collectTimers();
+        if (timers.empty()) return -1;
+        auto left = timers.top().at - std::chrono::steady_clock::now();
+        if (left <= std::chrono::steady_clock::duration::zero()) return 0;
+        return (int)std::chrono::ceil<std::chrono::milliseconds>(left).count();
+    }
+public:
+    QuizServer(BankCache &b, const QuizServerConfig &c, const QuizServerHooks &h)
+        : banks(b), config(c), hooks(h) {}
+
+    QuizServer(const QuizServer &) = delete;
+    QuizServer &operator=(const QuizServer &) = delete;
+
+    ~QuizServer() {
+        if (listenFd >= 0) close(listenFd);
+        if (wakeFd >= 0) close(wakeFd);
+        if (signalFd >= 0) close(signalFd);
+        if (epollFd >= 0) close(epollFd);
+        if (config.tcpPort == 0 && listenFd >= 0) unlink(config.unixPath.c_str());
+    }
+
+    // Serve until SIGINT or SIGTERM
+    bool run() {
+        if (!listen()) return false;
+
+        // Signals are taken through a descriptor so the loop can stop cleanly.
+        // A shell starts background jobs with SIGINT ignored, which would hide it from the descriptor.
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGINT);
+        sigaddset(&mask, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &mask, nullptr);  // Inherited by the workers
+
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (epollFd < 0 || wakeFd < 0 || signalFd < 0) return false;
+        watch(listenFd, LISTEN_KEY);
+        watch(wakeFd, WAKE_KEY);
+        watch(signalFd, SIGNAL_KEY);
+
+        size_t workers = config.workers ? config.workers : std::max(2u, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < workers; ++i) pool.emplace_back(&QuizServer::workerLoop, this);
+
+        bool running = true;
+        epoll_event events[256];
+        while (running) {
+            int n = epoll_wait(epollFd, events, 256, nextTimeoutMs());
+            if (n < 0 && errno != EINTR) break;
+            for (int i = 0; i < n; ++i) {
+                uint64_t key = events[i].data.u64;
+                if (key == LISTEN_KEY) {
+                    acceptAll();
+                } else if (key == WAKE_KEY) {
+                    uint64_t count;
+                    while (read(wakeFd, &count, sizeof(count)) > 0) {
+                    }
+                } else if (key == SIGNAL_KEY) {
+                    signalfd_siginfo info;
+                    while (read(signalFd, &info, sizeof(info)) > 0) {
+                    }
+                    running = false;
+                } else {
+                    auto it = sessions.find(key);
+                    if (it == sessions.end()) continue;
+                    std::shared_ptr<Session> s = it->second;
+                    bool open = true;
+                    if (events[i].events & EPOLLIN) open = readInput(s);
+                    if (events[i].events & EPOLLOUT) {
+                        std::lock_guard<std::mutex> lock(s->lock);
+                        sendPending(*s);
+                    }
+                    if (!open || (events[i].events & (EPOLLHUP | EPOLLERR))) drop(key);
+                }
+            }
+            fireTimers();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(workLock);
+            stopping = true;
+        }
+        workReady.notify_all();
+        for (std::thread &t : pool) t.join();
+        sessions.clear();
+        pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+        return true;
+    }
+};
+
+#endif
+
+// Run the server until it is stopped; false if it could not start
+inline bool runQuizServer(BankCache &banks, const QuizServerConfig &config, const QuizServerHooks &hooks) {
+#ifdef _WIN32
+    (void)banks;
+    (void)config;
+    (void)hooks;
+    std::cout << "Server mode is only available on Linux.\n";
+    return false;
+#else
+    QuizServer server(banks, config, hooks);
+    return server.run();
+#endif
+}
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Per-phase latency instrumentation of quiz sessions.
+//
+// Compiled in only with -DQUIZ_TRACE (g++ -DQUIZ_TRACE final.cpp). Without
+// it TRACE_SPAN expands to nothing and the report functions just say that
+// timing is not compiled in, so a normal build pays nothing.
+//
+// TRACE_SPAN(phase) times the rest of the enclosing scope with steady_clock
+// and puts the span in a ring buffer owned by the calling thread, which takes
+// no lock. When a ring fills up, its thread folds it into its own
+// histograms. A report merges every thread's histograms with whatever is
+// still waiting in the rings. The histograms are HDR-style: 32 linear
+// sub-buckets for every power of two of nanoseconds, so any percentile is
+// within about 3% of the true value.
+
+#include <string>
+
+enum TracePhase {
+    TRACE_OPEN,    // Opening data files (stats store, result log, leaderboard)
+    TRACE_PARSE,   // Loading or reloading the question bank
+    TRACE_RENDER,  // Building and writing a screen
+    TRACE_WAIT,    // Waiting for the student to answer
+    TRACE_STATS,   // Recording an answer in the question statistics
+    TRACE_SAVE,    // Logging a finished quiz's result
+    TRACE_PHASE_COUNT
+};
+
+#ifdef QUIZ_TRACE
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#include "platform.h"
+
+inline const char *tracePhaseName(int phase) {
+    static const char *const names[TRACE_PHASE_COUNT] = {"open", "parse", "render", "wait", "stats", "save"};
+    return names[phase];
+}
+
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+private:
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t largest = 0;
+
+    static int highestBit(uint64_t v) {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(v);
+#else
+        int h = 0;
+        while (v >>= 1) ++h;
+        return h;
+#endif
+    }
+public:
+    // Values below SUB_BUCKETS get a bucket each; above, a power of two is
+    // split into SUB_BUCKETS equal parts
+    static size_t bucketOf(uint64_t ns) {
+        if (ns < SUB_BUCKETS) return (size_t)ns;
+        int shift = highestBit(ns) - SUB_BITS;
+        return (size_t)((shift + 1) * SUB_BUCKETS + ((ns >> shift) - SUB_BUCKETS));
+    }
+
+    // Highest value that falls in a bucket
+    static uint64_t bucketLimit(size_t bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+        int shift = (int)(bucket / SUB_BUCKETS) - 1;
+        uint64_t sub = bucket % SUB_BUCKETS + SUB_BUCKETS;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t ns) {
+        counts[bucketOf(ns)]++;
+        total++;
+        sum += ns;
+        largest = std::max(largest, ns);
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        largest = std::max(largest, other.largest);
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return largest; }
+    double mean() const { return total ? (double)sum / total : 0; }
+    uint64_t bucketCount(size_t bucket) const { return counts[bucket]; }
+
+    // Value at or below which 'p' percent of the samples fall
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(p / 100 * total)), seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucketLimit(i), largest);
+        }
+        return largest;
+    }
+};
+
+// The spans and histograms of one thread
+class TraceThread {
+private:
+    struct Span {
+        int phase;
+        uint64_t ns;
+    };
+    static constexpr size_t RING_SIZE = 4096;
+
+    Span ring[RING_SIZE];
+    std::atomic<size_t> used{0};  // Spans in the ring; written by the owning thread only
+    std::mutex lock;              // Held to fold the ring or to read it from another thread
+    LatencyHistogram histograms[TRACE_PHASE_COUNT];
+
+    void foldLocked() {
+        size_t n = used.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i) histograms[ring[i].phase].record(ring[i].ns);
+        used.store(0, std::memory_order_release);
+    }
+public:
+    void add(int phase, uint64_t ns) {
+        size_t n = used.load(std::memory_order_relaxed);
+        if (n == RING_SIZE) {
+            std::lock_guard<std::mutex> guard(lock);
+            foldLocked();
+            n = 0;
+        }
+        ring[n] = Span{phase, ns};
+        used.store(n + 1, std::memory_order_release);
+    }
+
+    // Add this thread's latencies so far to 'out'
+    void collect(LatencyHistogram out[TRACE_PHASE_COUNT]) {
+        std::lock_guard<std::mutex> guard(lock);
+        size_t n = used.load(std::memory_order_acquire);
+        for (int p = 0; p < TRACE_PHASE_COUNT; ++p) out[p].merge(histograms[p]);
+        for (size_t i = 0; i < n; ++i) out[ring[i].phase].record(ring[i].ns);
+    }
+};
+
+// Every thread that has recorded a span. Never destroyed, so a report can
+// still be written while the program exits.
+class TraceRegistry {
+private:
+    std::mutex lock;
+    std::vector<TraceThread *> threads;
+    LatencyHistogram finished[TRACE_PHASE_COUNT];  // Threads that have exited
+public:
+    static TraceRegistry &instance() {
+        static TraceRegistry *registry = new TraceRegistry();
+        return *registry;
+    }
+
+    void enter(TraceThread *t) {
+        std::lock_guard<std::mutex> guard(lock);
+        threads.push_back(t);
+    }
+
+    void leave(TraceThread *t) {
+        std::lock_guard<std::mutex> guard(lock);
+        t->collect(finished);
+        threads.erase(std::find(threads.begin(), threads.end(), t));
+    }
+
+    void collect(LatencyHistogram out[TRACE_PHASE_COUNT]) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int p = 0; p < TRACE_PHASE_COUNT; ++p) out[p].merge(finished[p]);
+        for (TraceThread *t : threads) t->collect(out);
+    }
+};
+
+inline TraceThread &currentTraceThread() {
+    struct Handle {
+        TraceThread *thread = new TraceThread();
+        Handle() { TraceRegistry::instance().enter(thread); }
+        ~Handle() {
+            TraceRegistry::instance().leave(thread);
+            delete thread;
+        }
+    };
+    thread_local Handle handle;
+    return *handle.thread;
+}
+
+// Times the rest of its scope
+class TraceScope {
+private:
+    int phase;
+    std::chrono::steady_clock::time_point start;
+public:
+    explicit TraceScope(int p) : phase(p), start(std::chrono::steady_clock::now()) {}
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+    ~TraceScope() {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        currentTraceThread().add(phase, (uint64_t)std::max<int64_t>(0, ns));
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(phase) TraceScope TRACE_CONCAT(traceSpan, __LINE__)(phase)
+
+// Table of every phase's latencies so far, in microseconds
+inline std::string traceReport() {
+    std::vector<LatencyHistogram> h(TRACE_PHASE_COUNT);
+    TraceRegistry::instance().collect(h.data());
+    std::ostringstream out;
+    out << std::left << std::setw(8) << "phase" << std::right << std::setw(10) << "count" << std::setw(12) << "mean us"
+        << std::setw(12) << "p50 us" << std::setw(12) << "p90 us" << std::setw(12) << "p99 us" << std::setw(12)
+        << "max us" << "\n"
+        << std::fixed << std::setprecision(1);
+    for (int p = 0; p < TRACE_PHASE_COUNT; ++p) {
+        out << std::left << std::setw(8) << tracePhaseName(p) << std::right << std::setw(10) << h[p].count()
+            << std::setw(12) << h[p].mean() / 1000 << std::setw(12) << h[p].percentile(50) / 1000.0 << std::setw(12)
+            << h[p].percentile(90) / 1000.0 << std::setw(12) << h[p].percentile(99) / 1000.0 << std::setw(12)
+            << h[p].max() / 1000.0 << "\n";
+    }
+    return out.str();
+}
+
+// Every phase's histogram as JSON: summary percentiles plus the non-empty
+// buckets as [highest value in ns, count] pairs
+inline bool writeTraceJson(const std::string &path) {
+    std::vector<LatencyHistogram> h(TRACE_PHASE_COUNT);
+    TraceRegistry::instance().collect(h.data());
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+    file << std::fixed << std::setprecision(3) << "{\n  \"phases\": [\n";
+    for (int p = 0; p < TRACE_PHASE_COUNT; ++p) {
+        const LatencyHistogram &x = h[p];
+        file << "    {\"name\": \"" << tracePhaseName(p) << "\", \"count\": " << x.count()
+             << ", \"mean_us\": " << x.mean() / 1000 << ", \"p50_us\": " << x.percentile(50) / 1000.0
+             << ", \"p90_us\": " << x.percentile(90) / 1000.0 << ", \"p99_us\": " << x.percentile(99) / 1000.0
+             << ", \"p999_us\": " << x.percentile(99.9) / 1000.0 << ", \"max_us\": " << x.max() / 1000.0
+             << ", \"buckets\": [";
+        bool first = true;
+        for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+            if (x.bucketCount(b) == 0) continue;
+            file << (first ? "" : ", ") << "[" << LatencyHistogram::bucketLimit(b) << ", " << x.bucketCount(b) << "]";
+            first = false;
+        }
+        file << "]}" << (p + 1 < TRACE_PHASE_COUNT ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return (bool)file;
+}
+
+// Print the report to stderr whenever the process gets SIGUSR1. Call before
+// any other thread starts (see blockWaitedSignals()).
+inline void installTraceSignal() {
+#ifndef _WIN32
+    blockWaitedSignals();
+    std::thread([] {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGUSR1);
+        int sig;
+        while (sigwait(&set, &sig) == 0) {
+            std::string report = traceReport();
+            if (write(2, report.data(), report.size()) < 0) {
+                // Nowhere left to report to
+            }
+        }
+    }).detach();
+#endif
+}
+
+#else
+
+#define TRACE_SPAN(phase) ((void)0)
+
+inline std::string traceReport() { return "Timing is not compiled in (build with -DQUIZ_TRACE).\n"; }
+inline bool writeTraceJson(const std::string &) { return true; }
+inline void installTraceSignal() {}
+
+#endif
+
+#endif
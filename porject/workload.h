@@ -0,0 +1,202 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+// Synthetic data and latency bookkeeping for benchmark.cpp.
+//
+// The generators write files in exactly the formats the quiz program reads,
+// so every benchmark runs the real code paths on realistic input.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "leaderboard.h"
+#include "question_bank.h"
+#include "question_stats.h"
+#include "response_log.h"
+
+struct WorkloadConfig {
+    size_t questions = 100000;
+    double mcqRatio = 0.75;       // Share of MCQ questions, the rest are TF
+    size_t textLength = 60;       // Average question text length
+    size_t optionLength = 16;     // Average option length
+    size_t leaderboardRows = 100000;
+    size_t students = 20000;      // Distinct student IDs in the leaderboard
+    size_t statsEntries = 100000; // Questions with existing statistics
+    size_t responses = 2000000;   // Logged answers for item analysis
+    size_t attemptLength = 40;    // Answers per logged attempt
+    uint64_t seed = 42;
+};
+
+// Random lowercase words of about 'length' characters (length 0 stays empty)
+inline std::string syntheticText(std::mt19937_64 &rng, size_t length) {
+    if (length == 0) return "";
+    std::uniform_int_distribution<size_t> len(length / 2 + 1, length + length / 2);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> space(0, 6);
+    size_t n = len(rng);
+    std::string s;
+    s.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        s += (i > 0 && i + 1 < n && space(rng) == 0) ? ' ' : (char)letter(rng);
+    }
+    return s;
+}
+
+// Write a questions.txt with config.questions questions
+inline bool generateQuestionBank(const std::string &path, const WorkloadConfig &config) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    std::mt19937_64 rng(config.seed);
+    std::bernoulli_distribution isMcq(config.mcqRatio);
+    std::uniform_int_distribution<int> option(1, MAX_OPTIONS), truth(1, 2);
+
+    std::string buffer;
+    for (size_t i = 0; i < config.questions; ++i) {
+        if (isMcq(rng)) {
+            buffer += "MCQ\n" + syntheticText(rng, config.textLength) + "\n";
+            for (int o = 0; o < MAX_OPTIONS; ++o) buffer += syntheticText(rng, config.optionLength) + "\n";
+            buffer += std::to_string(option(rng)) + "\n";
+        } else {
+            buffer += "TF\n" + syntheticText(rng, config.textLength) + "\n" + std::to_string(truth(rng)) + "\n";
+        }
+        if (buffer.size() > (1 << 20)) {
+            out.write(buffer.data(), (std::streamsize)buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), (std::streamsize)buffer.size());
+    return (bool)out;
+}
+
+// Write a leaderboard.txt with config.leaderboardRows results
+inline bool generateLeaderboard(const std::string &path, const WorkloadConfig &config) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    std::mt19937_64 rng(config.seed + 1);
+    std::uniform_int_distribution<int> student(1, (int)std::max<size_t>(1, config.students));
+    std::uniform_int_distribution<int> correct(0, 20);
+
+    std::string buffer;
+    for (size_t i = 0; i < config.leaderboardRows; ++i) {
+        int id = student(rng);
+        appendLeaderboardRow(buffer, "Student " + std::to_string(id), id, correct(rng) * 10);
+        if (buffer.size() > (1 << 20)) {
+            out.write(buffer.data(), (std::streamsize)buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), (std::streamsize)buffer.size());
+    return (bool)out;
+}
+
+// Write an answer sheet file for grader.h, answering right about half the time
+inline bool generateAnswerSheets(const std::string &path, const QuestionBank &bank, size_t sheets,
+                                 const WorkloadConfig &config) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) return false;
+    std::mt19937_64 rng(config.seed + 3);
+    std::bernoulli_distribution right(0.5);
+    std::uniform_int_distribution<int> option(1, MAX_OPTIONS);
+
+    std::string buffer;
+    for (size_t s = 0; s < sheets; ++s) {
+        buffer += std::to_string(s + 1) + ",Student " + std::to_string(s + 1);
+        for (size_t i = 0; i < bank.size(); ++i) {
+            QuestionRecord q = bank.question(i);
+            buffer += ',';
+            buffer += std::to_string(right(rng) ? q.correctAnswer : option(rng));
+        }
+        buffer += '\n';
+        if (buffer.size() > (1 << 20)) {
+            out.write(buffer.data(), (std::streamsize)buffer.size());
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), (std::streamsize)buffer.size());
+    return (bool)out;
+}
+
+// Write a responses.dat of config.responses answers to the first 'questions'
+// question IDs. Students and questions follow a two-parameter logistic
+// model, so abler students do better and the statistics mean something.
+inline bool generateResponses(const std::string &path, size_t questions, const WorkloadConfig &config) {
+    std::remove(path.c_str());
+    ResponseLog log;
+    if (questions == 0 || !log.open(path)) return false;
+    std::mt19937_64 rng(config.seed + 4);
+    std::normal_distribution<double> normal(0, 1);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::uniform_int_distribution<uint32_t> question(1, (uint32_t)std::min<size_t>(questions, UINT32_MAX));
+    std::vector<double> difficulty(questions + 1), slope(questions + 1);
+    for (size_t i = 1; i <= questions; ++i) {
+        difficulty[i] = normal(rng);
+        slope[i] = 0.5 + uniform(rng) * 1.5;
+    }
+
+    size_t length = std::max<size_t>(1, config.attemptLength);
+    std::vector<ResponseRecord> batch;
+    for (size_t written = 0; written < config.responses;) {
+        double ability = normal(rng);
+        for (size_t i = 0; i < length && written < config.responses; ++i, ++written) {
+            uint32_t id = question(rng);
+            int key = (int)(id % MAX_OPTIONS) + 1;
+            // Wrong answers favour the option after the key; 0 is time up
+            bool correct = uniform(rng) < 1 / (1 + std::exp(-1.7 * slope[id] * (ability - difficulty[id])));
+            int choice = correct ? key : (key + 1 + (int)(uniform(rng) * uniform(rng) * (MAX_OPTIONS - 1))) % (MAX_OPTIONS + 1);
+            batch.push_back(makeResponse(id, choice, MAX_OPTIONS, correct));
+            if (i == 0) batch.back().flags |= RESPONSE_FIRST;
+        }
+        if (batch.size() >= (1 << 16)) {
+            if (!log.append(batch)) return false;
+            batch.clear();
+        }
+    }
+    return log.append(batch);
+}
+
+// Create a question_stats.dat holding config.statsEntries questions
+inline bool generateStats(const std::string &path, const WorkloadConfig &config) {
+    std::remove(path.c_str());
+    QuestionStatsStore store;
+    if (!store.open(path)) return false;
+    std::mt19937_64 rng(config.seed + 2);
+    std::uniform_int_distribution<uint32_t> attempts(1, 500);
+    std::vector<QuestionStat> changes;
+    for (size_t i = 1; i <= config.statsEntries; ++i) {
+        uint32_t a = attempts(rng);
+        changes.push_back(QuestionStat{(uint32_t)i, a, a / 2, 0});
+    }
+    return store.update(changes);
+}
+
+// Latencies of one operation, in nanoseconds
+class LatencySamples {
+private:
+    std::vector<double> samples;
+    bool sorted = false;
+public:
+    void add(double ns) {
+        samples.push_back(ns);
+        sorted = false;
+    }
+
+    size_t count() const { return samples.size(); }
+
+    double percentile(double p) {
+        if (samples.empty()) return 0;
+        if (!sorted) {
+            std::sort(samples.begin(), samples.end());
+            sorted = true;
+        }
+        size_t i = (size_t)(p / 100.0 * (double)(samples.size() - 1) + 0.5);
+        return samples[std::min(i, samples.size() - 1)];
+    }
+};
+
+#endif